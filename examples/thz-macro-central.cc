@@ -28,6 +28,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/network-module.h"
+#include "ns3/thz-band-presets.h"
 #include "ns3/thz-channel.h"
 #include "ns3/thz-dir-antenna.h"
 #include "ns3/thz-directional-antenna-helper.h"
@@ -128,15 +129,15 @@ main(int argc, char* argv[])
     // Config 1: True THz window (90 GHz wide at fc = 1.0345 THz). Don't use Adaptive MCS - data rates are for 802.15.3d window
     if (configuration == 1)
     {
-        txPower = 0;             // [dBm] Transmit power
-        bandwidth = 90e9;        // [Hz] Bandwidth
-        centralFreq = 1.0345e12; // [Hz] Central frequency
-        radius = 2.7;            // [m] Radius
-        dataRate = 1.8e11;       // [bps] Data rate
-        basicRate = 1.8e11;      // [bps] Basic rate
-        bit_energy = 10.6;       // [dB] Eb/N0
-        beamwidth = 6;           // [deg] Beamwidth
-        maxGain = 30.59;         // [dBi] Maximum gain
+        txPower = 0;                                          // [dBm] Transmit power
+        bandwidth = THZ_PRESET_1_0345_THZ.totalBandWidth;     // [Hz] Bandwidth
+        centralFreq = THZ_PRESET_1_0345_THZ.centralFrequency; // [Hz] Central frequency
+        radius = 2.7;                                         // [m] Radius
+        dataRate = 1.8e11;                                    // [bps] Data rate
+        basicRate = 1.8e11;                                   // [bps] Basic rate
+        bit_energy = 10.6;                                    // [dB] Eb/N0
+        beamwidth = 6;                                        // [deg] Beamwidth
+        maxGain = 30.59;                                      // [dBi] Maximum gain
 
         sinrTh = bit_energy + 10 * log10(dataRate / bandwidth);                     // [dB] SINR_th = Eb/N0*R/B
         noiseFloor = 10 * log10(BOLTZMANN_CONSTANT * temperature * bandwidth) + 30; // [dBm] Noise floor = kTB
@@ -147,9 +148,11 @@ main(int argc, char* argv[])
         use_adaptMCS = false;
 
         Config::SetDefault("ns3::THzSpectrumValueFactory::TotalBandWidth", DoubleValue(bandwidth));
-        Config::SetDefault("ns3::THzSpectrumValueFactory::NumSample", DoubleValue(32));
+        Config::SetDefault("ns3::THzSpectrumValueFactory::NumSample",
+                           DoubleValue(THZ_PRESET_1_0345_THZ.numSample));
         Config::SetDefault("ns3::THzSpectrumValueFactory::CentralFrequency", DoubleValue(centralFreq));
-        Config::SetDefault("ns3::THzSpectrumValueFactory::SubBandWidth", DoubleValue(9e8));
+        Config::SetDefault("ns3::THzSpectrumValueFactory::SubBandWidth",
+                           DoubleValue(THZ_PRESET_1_0345_THZ.subBandWidth));
         Config::SetDefault("ns3::THzSpectrumValueFactory::NumSubBand", DoubleValue(100));
     }
 
@@ -158,8 +161,8 @@ main(int argc, char* argv[])
     else
     {
         txPower = 20;
-        bandwidth = 69.12e9;
-        centralFreq = 287.28e9;
+        bandwidth = THZ_PRESET_802_15_3D.totalBandWidth;
+        centralFreq = THZ_PRESET_802_15_3D.centralFrequency;
 
         if (configuration == 20)
         {
@@ -297,9 +300,11 @@ main(int argc, char* argv[])
         maxGain = 20 * log10(sectors) - 4.971498726941338;
 
         Config::SetDefault("ns3::THzSpectrumValueFactory::TotalBandWidth", DoubleValue(bandwidth));
-        Config::SetDefault("ns3::THzSpectrumValueFactory::NumSample", DoubleValue(32));
+        Config::SetDefault("ns3::THzSpectrumValueFactory::NumSample",
+                           DoubleValue(THZ_PRESET_802_15_3D.numSample));
         Config::SetDefault("ns3::THzSpectrumValueFactory::CentralFrequency", DoubleValue(centralFreq));
-        Config::SetDefault("ns3::THzSpectrumValueFactory::SubBandWidth", DoubleValue(2.16e9));
+        Config::SetDefault("ns3::THzSpectrumValueFactory::SubBandWidth",
+                           DoubleValue(THZ_PRESET_802_15_3D.subBandWidth));
         Config::SetDefault("ns3::THzSpectrumValueFactory::NumSubBand", DoubleValue(32));
     }
 
@@ -47,6 +47,14 @@ THzDirectionalAntennaHelper::Default(void)
     return helper;
 }
 
+THzDirectionalAntennaHelper
+THzDirectionalAntennaHelper::Codebook(void)
+{
+    THzDirectionalAntennaHelper helper;
+    helper.SetType("ns3::THzCodebookAntenna");
+    return helper;
+}
+
 void
 THzDirectionalAntennaHelper::SetType(std::string type,
                                      std::string n0, const AttributeValue& v0,
@@ -53,6 +53,12 @@ class THzDirectionalAntennaHelper : public THzDirAntennaHelper
      */
     static THzDirectionalAntennaHelper Default(void);
 
+    /**
+     * Create a THz directional antenna helper that installs THzCodebookAntenna, a phased array
+     * with a codebook of precomputed beams.
+     */
+    static THzDirectionalAntennaHelper Codebook(void);
+
     /**
      * Set the underlying type of the THz directional antenna and its attributes.
      *
@@ -0,0 +1,468 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "thz-absorption-table.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define THZ_HAVE_MMAP
+#endif
+
+#ifndef THZ_DATA_DIR
+#define THZ_DATA_DIR "contrib/thz/model"
+#endif
+#ifndef THZ_INSTALL_DATA_DIR
+#define THZ_INSTALL_DATA_DIR THZ_DATA_DIR
+#endif
+
+NS_LOG_COMPONENT_DEFINE("THzAbsorptionTable");
+
+namespace ns3
+{
+
+namespace
+{
+/**
+ * Header of a binary table, followed by the frequency grid and the coefficients as two
+ * arrays of size doubles in the byte order of the machine that wrote them.
+ */
+struct BinaryHeader
+{
+    char magic[8];      //!< THZABS01
+    uint32_t byteOrder; //!< 0x01020304 as written by the producing machine
+    uint32_t reserved;
+    uint64_t size; //!< number of grid points
+};
+
+const char BINARY_MAGIC[8] = {'T', 'H', 'Z', 'A', 'B', 'S', '0', '1'};
+const uint32_t BINARY_BYTE_ORDER = 0x01020304;
+} // namespace
+
+THzAbsorptionTable::THzAbsorptionTable(const std::string& frequencyFile,
+                                       const std::string& absCoeFile)
+    : m_map(0),
+      m_mapLength(0)
+{
+    std::ifstream frequencyfile;
+    frequencyfile.open(frequencyFile.c_str(), std::ifstream::in);
+    if (!frequencyfile.is_open())
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: open " << frequencyFile << " failed");
+    }
+    std::ifstream AbsCoefile;
+    AbsCoefile.open(absCoeFile.c_str(), std::ifstream::in);
+    if (!AbsCoefile.is_open())
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: open " << absCoeFile << " failed");
+    }
+
+    double value;
+    while (frequencyfile >> value)
+    {
+        m_frequencyData.push_back(value);
+    }
+    while (AbsCoefile >> value)
+    {
+        m_coefficientData.push_back(value);
+    }
+    if (m_frequencyData.empty() || m_frequencyData.size() != m_coefficientData.size())
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: " << frequencyFile << " has " << m_frequencyData.size()
+                                              << " entries but " << absCoeFile << " has "
+                                              << m_coefficientData.size());
+    }
+    m_frequency = m_frequencyData.data();
+    m_coefficient = m_coefficientData.data();
+    m_size = m_frequencyData.size();
+    Validate(absCoeFile);
+}
+
+THzAbsorptionTable::THzAbsorptionTable(const std::string& binaryFile)
+    : m_frequency(0),
+      m_coefficient(0),
+      m_size(0),
+      m_map(0),
+      m_mapLength(0)
+{
+    const char* data = 0;
+    std::size_t length = 0;
+#ifdef THZ_HAVE_MMAP
+    int fd = open(binaryFile.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: open " << binaryFile << " failed");
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        length = st.st_size;
+        m_map = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m_map == MAP_FAILED)
+        {
+            m_map = 0;
+        }
+    }
+    close(fd);
+    if (!m_map)
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: mmap " << binaryFile << " failed");
+    }
+    m_mapLength = length;
+    data = static_cast<const char*>(m_map);
+#else
+    std::ifstream file(binaryFile.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!file.is_open())
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: open " << binaryFile << " failed");
+    }
+    std::vector<char> content((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    // keep the doubles aligned by copying into the vectors below
+    length = content.size();
+    data = content.data();
+#endif
+
+    BinaryHeader header;
+    if (length < sizeof(header))
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: " << binaryFile << " is too short");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+        header.byteOrder != BINARY_BYTE_ORDER)
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: " << binaryFile
+                                              << " is not a binary table of this machine");
+    }
+    if (header.size == 0 || length != sizeof(header) + 2 * header.size * sizeof(double))
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: " << binaryFile << " has a wrong size");
+    }
+    m_size = header.size;
+    const double* values = reinterpret_cast<const double*>(data + sizeof(header));
+#ifdef THZ_HAVE_MMAP
+    m_frequency = values;
+    m_coefficient = values + m_size;
+#else
+    m_frequencyData.assign(values, values + m_size);
+    m_coefficientData.assign(values + m_size, values + 2 * m_size);
+    m_frequency = m_frequencyData.data();
+    m_coefficient = m_coefficientData.data();
+#endif
+    Validate(binaryFile);
+}
+
+THzAbsorptionTable::~THzAbsorptionTable()
+{
+#ifdef THZ_HAVE_MMAP
+    if (m_map)
+    {
+        munmap(m_map, m_mapLength);
+    }
+#endif
+}
+
+void
+THzAbsorptionTable::Validate(const std::string& source) const
+{
+    NS_ASSERT_MSG(std::is_sorted(m_frequency, m_frequency + m_size),
+                  "THzAbsorptionTable: frequency grid must be in ascending order");
+    NS_LOG_INFO("Loaded " << m_size << " absorption coefficients from " << source);
+}
+
+std::string
+THzAbsorptionTable::GetDataDirectory()
+{
+    const char* dir = std::getenv("THZ_DATA_DIR");
+    if (dir && *dir)
+    {
+        return dir;
+    }
+    // the build tree is gone once the module is installed and the build directory removed
+    if (std::ifstream(THZ_DATA_DIR "/data_frequency.txt").good())
+    {
+        return THZ_DATA_DIR;
+    }
+    return THZ_INSTALL_DATA_DIR;
+}
+
+Ptr<THzAbsorptionTable>
+THzAbsorptionTable::Load(const std::string& dir)
+{
+    std::string binaryFile = dir + "/data_absorption.bin";
+    if (std::ifstream(binaryFile.c_str()).good())
+    {
+        return Create<THzAbsorptionTable>(binaryFile);
+    }
+    return Create<THzAbsorptionTable>(dir + "/data_frequency.txt", dir + "/data_AbsCoe.txt");
+}
+
+Ptr<const THzAbsorptionTable>
+THzAbsorptionTable::Get()
+{
+    static Ptr<const THzAbsorptionTable> table = Load(GetDataDirectory());
+    return table;
+}
+
+void
+THzAbsorptionTable::WriteBinary(const std::string& binaryFile) const
+{
+    std::ofstream file(binaryFile.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!file.is_open())
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: open " << binaryFile << " failed");
+    }
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.byteOrder = BINARY_BYTE_ORDER;
+    header.reserved = 0;
+    header.size = m_size;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_frequency), m_size * sizeof(double));
+    file.write(reinterpret_cast<const char*>(m_coefficient), m_size * sizeof(double));
+    if (!file)
+    {
+        NS_FATAL_ERROR("THzAbsorptionTable: write " << binaryFile << " failed");
+    }
+}
+
+uint32_t
+THzAbsorptionTable::GetSize() const
+{
+    return m_size;
+}
+
+double
+THzAbsorptionTable::GetFrequency(uint32_t i) const
+{
+    NS_ASSERT(i < m_size);
+    return m_frequency[i];
+}
+
+double
+THzAbsorptionTable::GetCoefficient(uint32_t i) const
+{
+    NS_ASSERT(i < m_size);
+    return m_coefficient[i];
+}
+
+uint32_t
+THzAbsorptionTable::FindFrequency(double f) const
+{
+    return std::lower_bound(m_frequency, m_frequency + m_size, f) - m_frequency;
+}
+
+double
+THzAbsorptionTable::GetNearestCoefficient(double f, double tolerance) const
+{
+    uint32_t i = FindFrequency(f - tolerance);
+    if (i == m_size || m_frequency[i] > f + tolerance)
+    {
+        return 0.0;
+    }
+    return m_coefficient[i];
+}
+
+double
+THzAbsorptionTable::InterpolateCoefficient(double f) const
+{
+    uint32_t i = FindFrequency(f);
+    if (i == 0)
+    {
+        return m_coefficient[0];
+    }
+    if (i == m_size)
+    {
+        return m_coefficient[m_size - 1];
+    }
+    double f0 = m_frequency[i - 1];
+    double f1 = m_frequency[i];
+    if (f1 == f0 || f1 == f)
+    {
+        return m_coefficient[i];
+    }
+    double w = (f - f0) / (f1 - f0);
+    return m_coefficient[i - 1] + w * (m_coefficient[i] - m_coefficient[i - 1]);
+}
+
+THzPagedAbsorptionTable::THzPagedAbsorptionTable(const std::string& binaryFile, uint32_t blockSize)
+    : m_fileName(binaryFile),
+      m_size(0),
+      m_blockSize(blockSize)
+{
+    NS_ASSERT(blockSize > 0);
+    m_file.open(binaryFile.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!m_file.is_open())
+    {
+        NS_FATAL_ERROR("THzPagedAbsorptionTable: open " << binaryFile << " failed");
+    }
+    BinaryHeader header;
+    m_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!m_file || std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+        header.byteOrder != BINARY_BYTE_ORDER || header.size == 0)
+    {
+        NS_FATAL_ERROR("THzPagedAbsorptionTable: " << binaryFile
+                                                   << " is not a binary table of this machine");
+    }
+    m_size = header.size;
+
+    // the first frequency of every block is enough to find the block of any frequency
+    uint32_t nBlocks = (m_size + m_blockSize - 1) / m_blockSize;
+    m_blockStart.resize(nBlocks);
+    std::vector<double> value;
+    for (uint32_t b = 0; b < nBlocks; b++)
+    {
+        Read(sizeof(header) + uint64_t(b) * m_blockSize * sizeof(double), 1, value);
+        m_blockStart[b] = value[0];
+    }
+    NS_ASSERT_MSG(std::is_sorted(m_blockStart.begin(), m_blockStart.end()),
+                  "THzPagedAbsorptionTable: frequency grid must be in ascending order");
+    NS_LOG_INFO("Opened " << m_size << " absorption coefficients in " << nBlocks
+                          << " blocks from " << binaryFile);
+}
+
+Ptr<const THzPagedAbsorptionTable>
+THzPagedAbsorptionTable::Get(const std::string& binaryFile)
+{
+    static std::map<std::string, Ptr<const THzPagedAbsorptionTable>> tables;
+    std::map<std::string, Ptr<const THzPagedAbsorptionTable>>::const_iterator it =
+        tables.find(binaryFile);
+    if (it == tables.end())
+    {
+        it = tables.insert(std::make_pair(binaryFile, Create<THzPagedAbsorptionTable>(binaryFile)))
+                 .first;
+    }
+    return it->second;
+}
+
+uint32_t
+THzPagedAbsorptionTable::GetSize() const
+{
+    return m_size;
+}
+
+uint32_t
+THzPagedAbsorptionTable::GetNLoadedBlocks() const
+{
+    return m_blocks.size();
+}
+
+void
+THzPagedAbsorptionTable::Read(uint64_t offset, uint32_t n, std::vector<double>& values) const
+{
+    values.resize(n);
+    m_file.clear();
+    m_file.seekg(offset);
+    m_file.read(reinterpret_cast<char*>(values.data()), n * sizeof(double));
+    if (!m_file)
+    {
+        NS_FATAL_ERROR("THzPagedAbsorptionTable: read " << m_fileName << " failed");
+    }
+}
+
+const THzPagedAbsorptionTable::Block&
+THzPagedAbsorptionTable::GetBlock(uint32_t b) const
+{
+    std::map<uint32_t, Block>::iterator it = m_blocks.find(b);
+    if (it == m_blocks.end())
+    {
+        uint32_t first = b * m_blockSize;
+        uint32_t n = std::min(m_blockSize, m_size - first);
+        Block block;
+        Read(sizeof(BinaryHeader) + uint64_t(first) * sizeof(double), n, block.frequency);
+        Read(sizeof(BinaryHeader) + (uint64_t(m_size) + first) * sizeof(double),
+             n,
+             block.coefficient);
+        NS_LOG_DEBUG("Read block " << b << " of " << m_fileName);
+        it = m_blocks.insert(std::make_pair(b, block)).first;
+    }
+    return it->second;
+}
+
+double
+THzPagedAbsorptionTable::GetFrequency(uint32_t i) const
+{
+    NS_ASSERT(i < m_size);
+    return GetBlock(i / m_blockSize).frequency[i % m_blockSize];
+}
+
+double
+THzPagedAbsorptionTable::GetCoefficient(uint32_t i) const
+{
+    NS_ASSERT(i < m_size);
+    return GetBlock(i / m_blockSize).coefficient[i % m_blockSize];
+}
+
+uint32_t
+THzPagedAbsorptionTable::FindFrequency(double f) const
+{
+    // block b is the first one starting at or above f, the grid points below it are in the
+    // previous block
+    uint32_t b = std::lower_bound(m_blockStart.begin(), m_blockStart.end(), f) - m_blockStart.begin();
+    if (b > 0)
+    {
+        const Block& prev = GetBlock(b - 1);
+        uint32_t i = std::lower_bound(prev.frequency.begin(), prev.frequency.end(), f) -
+                     prev.frequency.begin();
+        if (i < prev.frequency.size())
+        {
+            return (b - 1) * m_blockSize + i;
+        }
+    }
+    return std::min(b * m_blockSize, m_size);
+}
+
+double
+THzPagedAbsorptionTable::InterpolateCoefficient(double f) const
+{
+    uint32_t i = FindFrequency(f);
+    if (i == 0)
+    {
+        return GetCoefficient(0);
+    }
+    if (i == m_size)
+    {
+        return GetCoefficient(m_size - 1);
+    }
+    double f0 = GetFrequency(i - 1);
+    double f1 = GetFrequency(i);
+    if (f1 == f0 || f1 == f)
+    {
+        return GetCoefficient(i);
+    }
+    double w = (f - f0) / (f1 - f0);
+    double c0 = GetCoefficient(i - 1);
+    return c0 + w * (GetCoefficient(i) - c0);
+}
+
+} // namespace ns3
@@ -0,0 +1,258 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#ifndef THZ_ABSORPTION_TABLE_H
+#define THZ_ABSORPTION_TABLE_H
+
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup thz
+ * \brief In-memory copy of the molecular absorption coefficient database.
+ *
+ * Holds the frequency grid of data_frequency.txt and the matching absorption
+ * coefficients of data_AbsCoe.txt as two sorted arrays. The default table is
+ * loaded once per process by Get() and shared by every THzSpectrumPropagationLoss
+ * and THzSpectrumValueFactory instance, so the database is read only once.
+ *
+ * Besides the two text files, a table can be stored in a binary file written by
+ * WriteBinary (see the thz-absorption-db-converter example). Such a file is memory-mapped
+ * instead of parsed, which makes the startup of short runs much faster.
+ */
+class THzAbsorptionTable : public SimpleRefCount<THzAbsorptionTable>
+{
+  public:
+    /**
+     * \brief Load a table from a pair of text files.
+     *
+     * \param frequencyFile the frequency grid, one value in Hz per line, in ascending order.
+     * \param absCoeFile the absorption coefficients, one value per line, same length as
+     *        the frequency grid.
+     */
+    THzAbsorptionTable(const std::string& frequencyFile, const std::string& absCoeFile);
+
+    /**
+     * \brief Map a table from a binary file written by WriteBinary.
+     *
+     * \param binaryFile the binary table.
+     */
+    THzAbsorptionTable(const std::string& binaryFile);
+
+    ~THzAbsorptionTable();
+
+    /**
+     * \param dir a directory holding an absorption database.
+     *
+     * \return the table of data_absorption.bin in dir if that file exists, else the table of
+     *         data_frequency.txt and data_AbsCoe.txt in dir.
+     */
+    static Ptr<THzAbsorptionTable> Load(const std::string& dir);
+
+    /**
+     * \return the process-wide default table, loaded from GetDataDirectory () on the first call.
+     */
+    static Ptr<const THzAbsorptionTable> Get();
+
+    /**
+     * \return the directory of the absorption database: the THZ_DATA_DIR environment
+     *         variable if set, else the data directory of the build tree this module was built
+     *         in if it still exists, else the data directory the module was installed with.
+     */
+    static std::string GetDataDirectory();
+
+    /**
+     * \brief Store the table in the binary format read by the binary constructor.
+     *
+     * \param binaryFile the file to write.
+     */
+    void WriteBinary(const std::string& binaryFile) const;
+
+    /**
+     * \return the number of grid points.
+     */
+    uint32_t GetSize() const;
+
+    /**
+     * \param i the grid index.
+     * \return the frequency of grid point i, unit in Hz.
+     */
+    double GetFrequency(uint32_t i) const;
+
+    /**
+     * \param i the grid index.
+     * \return the absorption coefficient of grid point i.
+     */
+    double GetCoefficient(uint32_t i) const;
+
+    /**
+     * \param f the frequency, unit in Hz.
+     * \return the index of the first grid point whose frequency is not lower than f,
+     *         or GetSize() if there is none.
+     */
+    uint32_t FindFrequency(double f) const;
+
+    /**
+     * \brief Look up the coefficient of the first grid point within a window around f.
+     *
+     * \param f the frequency, unit in Hz.
+     * \param tolerance the half width of the search window, unit in Hz.
+     *
+     * \return the coefficient of the first grid point in [f - tolerance, f + tolerance],
+     *         or 0 when the window holds no grid point.
+     */
+    double GetNearestCoefficient(double f, double tolerance) const;
+
+    /**
+     * \brief Linearly interpolate the absorption coefficient at f.
+     *
+     * \param f the frequency, unit in Hz.
+     * \return the interpolated coefficient; values outside the grid are clamped to the
+     *         first or last grid point.
+     */
+    double InterpolateCoefficient(double f) const;
+
+  private:
+    /**
+     * \brief Check the grid and log the size of the table.
+     *
+     * \param source the file the table was read from.
+     */
+    void Validate(const std::string& source) const;
+
+    std::vector<double> m_frequencyData;   //!< frequency grid read from a text file
+    std::vector<double> m_coefficientData; //!< coefficients read from a text file
+    const double* m_frequency;   //!< frequency grid [Hz], ascending
+    const double* m_coefficient; //!< absorption coefficient of each grid point
+    uint32_t m_size;             //!< number of grid points
+    void* m_map;                 //!< mapping of a binary table, if any
+    std::size_t m_mapLength;     //!< length of m_map
+};
+
+/**
+ * \ingroup thz
+ * \brief Absorption coefficient database read block by block from a binary table.
+ *
+ * Meant for line-by-line tables with millions of grid points, such as one table per humidity
+ * level. Only the first frequency of every block is kept in memory when the table is opened;
+ * the grid points and coefficients of a block are read from the file the first time a lookup
+ * falls into it. Memory therefore grows with the frequency ranges actually looked up, which for
+ * THzSpectrumPropagationLoss are the bands of the spectrum models in use. The file has the
+ * format written by THzAbsorptionTable::WriteBinary.
+ */
+class THzPagedAbsorptionTable : public SimpleRefCount<THzPagedAbsorptionTable>
+{
+  public:
+    /**
+     * \param binaryFile the binary table.
+     * \param blockSize the number of grid points per block.
+     */
+    THzPagedAbsorptionTable(const std::string& binaryFile, uint32_t blockSize = 4096);
+
+    /**
+     * \param binaryFile the binary table.
+     *
+     * \return the table of binaryFile, opened on the first call for that file and shared
+     *         afterwards so the loaded blocks are reused by every user.
+     */
+    static Ptr<const THzPagedAbsorptionTable> Get(const std::string& binaryFile);
+
+    /**
+     * \return the number of grid points.
+     */
+    uint32_t GetSize() const;
+
+    /**
+     * \return the number of blocks read from the file so far.
+     */
+    uint32_t GetNLoadedBlocks() const;
+
+    /**
+     * \param i the grid index.
+     * \return the frequency of grid point i, unit in Hz.
+     */
+    double GetFrequency(uint32_t i) const;
+
+    /**
+     * \param i the grid index.
+     * \return the absorption coefficient of grid point i.
+     */
+    double GetCoefficient(uint32_t i) const;
+
+    /**
+     * \param f the frequency, unit in Hz.
+     * \return the index of the first grid point whose frequency is not lower than f,
+     *         or GetSize() if there is none.
+     */
+    uint32_t FindFrequency(double f) const;
+
+    /**
+     * \brief Linearly interpolate the absorption coefficient at f.
+     *
+     * \param f the frequency, unit in Hz.
+     * \return the interpolated coefficient; values outside the grid are clamped to the
+     *         first or last grid point.
+     */
+    double InterpolateCoefficient(double f) const;
+
+  private:
+    /**
+     * A block of consecutive grid points.
+     */
+    struct Block
+    {
+        std::vector<double> frequency;   //!< frequency of each grid point of the block
+        std::vector<double> coefficient; //!< coefficient of each grid point of the block
+    };
+
+    /**
+     * \param b the block index.
+     * \return block b, read from the file on first use.
+     */
+    const Block& GetBlock(uint32_t b) const;
+
+    /**
+     * \param offset the position in the file, unit in bytes.
+     * \param n the number of doubles to read.
+     * \param values filled with the doubles read.
+     */
+    void Read(uint64_t offset, uint32_t n, std::vector<double>& values) const;
+
+    std::string m_fileName;
+    mutable std::ifstream m_file;
+    uint32_t m_size;                              //!< number of grid points
+    uint32_t m_blockSize;                         //!< number of grid points per block
+    std::vector<double> m_blockStart;             //!< first frequency of each block
+    mutable std::map<uint32_t, Block> m_blocks;   //!< blocks read so far
+};
+
+} // namespace ns3
+
+#endif /* THZ_ABSORPTION_TABLE_H */
@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#ifndef THZ_BAND_PRESETS_H
+#define THZ_BAND_PRESETS_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * \ingroup thz
+ * \brief THzSpectrumValueFactory attributes of a standard frequency window.
+ */
+struct THzBandPreset
+{
+    double centralFrequency; //!< CentralFrequency (Hz)
+    double totalBandWidth;   //!< TotalBandWidth (Hz)
+    double subBandWidth;     //!< SubBandWidth (Hz)
+    int numSample;           //!< NumSample
+
+    /**
+     * \return the number of sub-bands the factory derives from the window.
+     */
+    constexpr int GetNumSubBand() const
+    {
+        return totalBandWidth / subBandWidth;
+    }
+};
+
+/// The 90 GHz wide window at 1.0345 THz (configuration 1 of thz-macro-central)
+constexpr THzBandPreset THZ_PRESET_1_0345_THZ = {1.0345e12, 90e9, 9e8, 32};
+
+/// The 69.12 GHz wide IEEE 802.15.3d window at 287.28 GHz (configurations 20-29)
+constexpr THzBandPreset THZ_PRESET_802_15_3D = {287.28e9, 69.12e9, 2.16e9, 32};
+
+/// Number of bands of the transmit PSD of the presets, for which a fixed-size kernel is built
+constexpr uint32_t THZ_PRESET_NUM_SAMPLE = 32;
+
+static_assert(THZ_PRESET_1_0345_THZ.numSample == THZ_PRESET_NUM_SAMPLE &&
+                  THZ_PRESET_802_15_3D.numSample == THZ_PRESET_NUM_SAMPLE,
+              "every preset must use the fixed-size kernel");
+
+/**
+ * \brief Band edges of the transmit PSD of a preset, relative to FreqStartValue - SubBandWidth / 2.
+ *
+ * \param preset the preset.
+ *
+ * \return the offset of the lower edge of band j at index j and of the upper edge of the last
+ * band at index N, unit in Hz; computed as in THzSpectrumValueFactory::CreateTxPowerSpectralDensity.
+ */
+template <std::size_t N>
+constexpr std::array<double, N + 1>
+MakeBandEdgeOffsets(const THzBandPreset& preset)
+{
+    std::array<double, N + 1> edges{};
+    for (std::size_t j = 0; j <= N; j++)
+    {
+        edges[j] = j * preset.subBandWidth * (preset.GetNumSubBand() / preset.numSample);
+    }
+    return edges;
+}
+
+/// Band edges of THZ_PRESET_1_0345_THZ
+constexpr std::array<double, THZ_PRESET_NUM_SAMPLE + 1> THZ_PRESET_1_0345_THZ_EDGES =
+    MakeBandEdgeOffsets<THZ_PRESET_NUM_SAMPLE>(THZ_PRESET_1_0345_THZ);
+
+/// Band edges of THZ_PRESET_802_15_3D
+constexpr std::array<double, THZ_PRESET_NUM_SAMPLE + 1> THZ_PRESET_802_15_3D_EDGES =
+    MakeBandEdgeOffsets<THZ_PRESET_NUM_SAMPLE>(THZ_PRESET_802_15_3D);
+
+/**
+ * \brief Path gain of many receivers for a transmit PSD of exactly N bands.
+ *
+ * \param psd the transmit PSD of every band.
+ * \param invSpread the inverse spreading loss at 1 m of every band.
+ * \param kf the absorption coefficient of every band.
+ * \param d the distance to each receiver, unit in meter.
+ * \param pathGain set to the path gain of each receiver, unit in Watt.
+ * \param nRx the number of receivers.
+ * \param sbw the sub-band bandwidth, unit in Hz.
+ * \param ratio the number of sub-bands over the number of samples.
+ *
+ * The band constants are held in fixed-size arrays so the band loop can be fully unrolled.
+ * Each receiver is summed in band order, as in the general kernel, so the results are equal.
+ */
+template <uint32_t N>
+void
+CalcFixedBandPathGain(const double* psd,
+                      const double* invSpread,
+                      const double* kf,
+                      const double* d,
+                      double* pathGain,
+                      std::size_t nRx,
+                      double sbw,
+                      double ratio)
+{
+    std::array<double, N> w;
+    std::array<double, N> k;
+    for (uint32_t i = 0; i < N; i++)
+    {
+        w[i] = psd[i] * invSpread[i];
+        k[i] = kf[i];
+    }
+    for (std::size_t r = 0; r < nRx; r++)
+    {
+        double sum = 0.0;
+        for (uint32_t i = 0; i < N; i++)
+        {
+            sum += w[i] * std::exp(-k[i] * d[r]);
+        }
+        double rxPsd_inte = sum / (d[r] * d[r]);
+        pathGain[r] = rxPsd_inte * sbw * ratio;
+    }
+}
+
+} // namespace ns3
+
+#endif /* THZ_BAND_PRESETS_H */
@@ -23,6 +23,8 @@
 
 #include "thz-channel.h"
 
+#include "ns3/angles.h"
+#include "ns3/boolean.h"
 #include "ns3/double.h"
 #include "ns3/log.h"
 #include "ns3/mac48-address.h"
@@ -36,6 +38,12 @@
 #include "ns3/thz-dir-antenna.h"
 #include "ns3/thz-mac-header.h"
 #include "ns3/thz-spectrum-propagation-loss.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
 
 NS_LOG_COMPONENT_DEFINE("THzChannel");
 
@@ -65,24 +73,100 @@ THzChannel::GetTypeId()
                           "Noise Floor (dBm)",
                           DoubleValue(-110.0),
                           MakeDoubleAccessor(&THzChannel::m_noiseFloor),
-                          MakeDoubleChecker<double>());
+                          MakeDoubleChecker<double>())
+            .AddAttribute("SpatialIndex",
+                          "If true, a transmission is only delivered to devices within the range "
+                          "at which it can still be received above the noise floor",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzChannel::m_spatialIndexEnabled),
+                          MakeBooleanChecker())
+            .AddAttribute("SpatialIndexCellSize",
+                          "Side length (m) of the grid cells of the spatial index",
+                          DoubleValue(10.0),
+                          MakeDoubleAccessor(&THzChannel::m_cellSize),
+                          MakeDoubleChecker<double>(1e-6))
+            .AddAttribute("LinkCache",
+                          "If true, the distance, delay, angles and path gain of each pair of "
+                          "static devices are cached until one of them changes course",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzChannel::m_linkCacheEnabled),
+                          MakeBooleanChecker())
+            .AddAttribute("WorkerThreads",
+                          "Number of threads computing the path gains of a transmission, "
+                          "including the simulation thread",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&THzChannel::SetWorkerThreads,
+                                               &THzChannel::GetWorkerThreads),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("BandPartitioning",
+                          "If true, a transmission is only delivered to the PHYs whose spectrum "
+                          "model overlaps the transmitted PSD",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzChannel::m_bandPartitioning),
+                          MakeBooleanChecker());
     return tid;
 }
 
 THzChannel::THzChannel()
-    : Channel()
+    : Channel(),
+      m_spatialIndexValid(false),
+      m_maxGainDb(0),
+      m_linkCacheHits(0),
+      m_linkCacheMisses(0),
+      m_workerThreads(1),
+      m_pool(0),
+      m_bandPartitioning(false),
+      m_bandsValid(false)
+{
+}
+
+void
+THzChannel::SetWorkerThreads(uint32_t workerThreads)
+{
+    NS_LOG_FUNCTION(this << workerThreads);
+    m_workerThreads = workerThreads;
+    m_pool = workerThreads > 1 ? Create<THzWorkerPool>(workerThreads) : 0;
+}
+
+uint32_t
+THzChannel::GetWorkerThreads() const
 {
+    return m_workerThreads;
 }
 
 THzChannel::~THzChannel()
 {
+    UntrackCourseChanges();
+}
+
+void
+THzChannel::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    Clear();
+    m_pool = 0;
+    Channel::DoDispose();
 }
 
 void
 THzChannel::Clear()
 {
+    UntrackCourseChanges();
     m_devList.clear();
     m_noiseEntry.clear();
+    m_freeSlots.clear();
+    m_rxPowerSumW.clear();
+    m_nOngoingRx.clear();
+    m_phyIndex.clear();
+    m_grid.clear();
+    m_devCell.clear();
+    m_devMobile.clear();
+    m_mobileDevs.clear();
+    m_epoch.clear();
+    m_maxGainDb = 0;
+    m_spatialIndexValid = false;
+    m_linkCache.clear();
+    m_bandsValid = false;
 }
 
 std::size_t
@@ -101,7 +185,12 @@ void
 THzChannel::AddDevice(Ptr<THzNetDevice> dev, Ptr<THzPhy> phy)
 {
     NS_LOG_INFO("CH: Adding dev/phy pair number " << m_devList.size() + 1);
+    m_phyIndex[phy] = m_devList.size();
     m_devList.push_back(std::make_pair(dev, phy));
+    m_bandsValid = false;
+    m_rxPowerSumW.push_back(0);
+    m_nOngoingRx.push_back(0);
+    m_spatialIndexValid = false;
 }
 
 bool
@@ -112,77 +201,523 @@ THzChannel::SendPacket(Ptr<THzSpectrumSignalParameters> txParams)
     Ptr<MobilityModel> YnodeMobility = 0; // initiation
     m_thzDA = 0;                          // initiation
 
+    // one read-only packet is shared by all receivers, detached from the packet kept by the
+    // sender; the receiving PHY copies it only when it hands the frame up to its MAC
     NoiseEntry ne;
-    ne.packet = txParams->packet;
+    ne.packet = txParams->packet->Copy();
     ne.txDuration = txParams->txDuration;
-    THzDeviceList::const_iterator it = m_devList.begin();
-    for (; it != m_devList.end(); it++)
-    {
-        if (txParams->txPhy == it->second)
-        {
-            m_sendDev = it->first;
-            XnodeMobility = it->first->GetNode()->GetObject<MobilityModel>();
-            m_XnodeMode = it->first->GetDirAntenna()->CheckAntennaMode();
-            m_thzDA = it->first->GetDirAntenna();
-            break;
-        }
-    }
+    ne.txPsd = txParams->txPsd;
+    std::map<Ptr<THzPhy>, uint32_t>::const_iterator sit = m_phyIndex.find(txParams->txPhy);
+    NS_ASSERT_MSG(sit != m_phyIndex.end(), "THzChannel::SendPacket: sender is not attached");
+    THzDeviceList::const_iterator it = m_devList.begin() + sit->second;
+    m_sendDev = it->first;
+    XnodeMobility = it->first->GetNode()->GetObject<MobilityModel>();
+    m_XnodeMode = it->first->GetDirAntenna()->CheckAntennaMode();
+    m_thzDA = it->first->GetDirAntenna();
     Simulator::Schedule(txParams->txDuration,
                         &THzChannel::SendPacketDone,
                         this,
                         txParams->txPhy,
                         txParams->packet);
-    uint32_t j = 0;
-    THzDeviceList::const_iterator itt = m_devList.begin();
-    for (; itt != m_devList.end(); itt++)
+
+    if ((m_spatialIndexEnabled || m_linkCacheEnabled) && m_tracked.size() < m_devList.size())
+    {
+        TrackCourseChanges();
+    }
+    // cached path gains are only valid for the absorption coefficients they were computed with
+    Ptr<const THzBandCoefficients> coefficients = 0;
+    if (m_linkCacheEnabled)
+    {
+        coefficients = m_loss->GetBandCoefficients(txParams->txPsd->GetSpectrumModel());
+    }
+    double range = std::numeric_limits<double>::infinity();
+    if (m_spatialIndexEnabled)
     {
-        if (txParams->txPhy != itt->second)
+        if (!m_spatialIndexValid)
         {
-            YnodeMobility = itt->first->GetNode()->GetObject<MobilityModel>();
-            m_YnodeMode = itt->first->GetDirAntenna()->CheckAntennaMode();
-            Time delay = m_delay->GetDelay(XnodeMobility, YnodeMobility); // propagation delay
-            if (m_XnodeMode == 1 && m_YnodeMode == 0) // 1--Receiver; 0--Transmitter
+            BuildSpatialIndex();
+        }
+        UpdateMaxGain();
+        range = m_loss->CalcMaxRange(txParams, m_maxGainDb, m_noiseFloor);
+        if (std::isnan(range))
+        {
+            range = std::numeric_limits<double>::infinity();
+        }
+        GetCandidateReceivers(XnodeMobility->GetPosition(), range, m_candidates);
+        NS_LOG_DEBUG("spatial index: " << m_candidates.size() << " of " << m_devList.size()
+                                       << " devices within " << range << " m");
+    }
+    if (m_bandPartitioning)
+    {
+        if (!m_bandsValid)
+        {
+            BuildBandPartition();
+        }
+        uint32_t band = GetBandIndex(txParams->txPsd->GetSpectrumModel());
+        if (m_spatialIndexEnabled)
+        {
+            std::size_t n = 0;
+            for (std::size_t k = 0; k < m_candidates.size(); k++)
             {
-                m_Rxorientation = m_thzDA->CheckRxOrientation(); // turning sector by sector
+                int32_t rxBand = m_devBand[m_candidates[k]];
+                if (rxBand < 0 || m_bandOverlap[band][rxBand])
+                {
+                    m_candidates[n++] = m_candidates[k];
+                }
             }
-            if (m_XnodeMode == 0 && m_YnodeMode == 1)
+            m_candidates.resize(n);
+        }
+        else
+        {
+            const std::vector<uint32_t>& members = GetBandMembers(band);
+            m_candidates.assign(members.begin(), members.end());
+        }
+        NS_LOG_DEBUG("band partitioning: " << m_candidates.size() << " of " << m_devList.size()
+                                           << " devices overlap the transmitted band");
+    }
+    else if (!m_spatialIndexEnabled)
+    {
+        m_candidates.resize(m_devList.size());
+        for (uint32_t i = 0; i < m_candidates.size(); i++)
+        {
+            m_candidates[i] = i;
+        }
+    }
+
+    // gather the link geometry of every receiver, from the link cache where possible, then
+    // compute the missing path gains at once
+    uint32_t txIndex = sit->second;
+    Vector XnodePos = XnodeMobility->GetPosition();
+    m_rxIndex.clear();
+    m_rxGainDb.clear();
+    m_rxDelay.clear();
+    m_rxPathGain.clear();
+    m_rxEntry.clear();
+    m_missIndex.clear();
+    m_missDistance.clear();
+    for (std::size_t k = 0; k < m_candidates.size(); k++)
+    {
+        uint32_t j = m_candidates[k];
+        THzDeviceList::const_iterator itt = m_devList.begin() + j;
+        if (txParams->txPhy == itt->second)
+        {
+            continue;
+        }
+        LinkEntry* entry = 0;
+        bool geometryValid = false;
+        if (m_linkCacheEnabled && !m_devMobile[txIndex] && !m_devMobile[j])
+        {
+            std::pair<LinkCache::iterator, bool> res =
+                m_linkCache.insert(std::make_pair(GetLinkKey(txIndex, j), LinkEntry()));
+            entry = &res.first->second;
+            geometryValid = !res.second && entry->txEpoch == m_epoch[txIndex] &&
+                            entry->rxEpoch == m_epoch[j];
+        }
+        double distance;
+        double azimuthXY;
+        double azimuthYX;
+        double elevationXY;
+        Time delay;
+        if (geometryValid)
+        {
+            distance = entry->distance;
+            azimuthXY = entry->azimuthXY;
+            azimuthYX = entry->azimuthYX;
+            elevationXY = entry->elevationXY;
+            delay = entry->delay;
+        }
+        else
+        {
+            YnodeMobility = itt->first->GetNode()->GetObject<MobilityModel>();
+            Vector YnodePos = YnodeMobility->GetPosition();
+            distance = CalculateDistance(XnodePos, YnodePos);
+            Angles anglesXY(YnodePos, XnodePos);
+            azimuthXY = anglesXY.GetAzimuth();
+            azimuthYX = Angles(XnodePos, YnodePos).GetAzimuth();
+            elevationXY = M_PI / 2 - anglesXY.GetInclination();
+            delay = m_delay->GetDelay(XnodeMobility, YnodeMobility); // propagation delay
+            if (entry)
             {
-                m_Rxorientation = itt->first->GetDirAntenna()->CheckRxOrientation();
+                entry->txEpoch = m_epoch[txIndex];
+                entry->rxEpoch = m_epoch[j];
+                entry->txPsd = 0;
+                entry->distance = distance;
+                entry->azimuthXY = azimuthXY;
+                entry->azimuthYX = azimuthYX;
+                entry->elevationXY = elevationXY;
+                entry->delay = delay;
             }
-            if (m_XnodeMode == 2 && m_YnodeMode == 2)
+        }
+        if (distance > range)
+        {
+            continue;
+        }
+        m_YnodeMode = itt->first->GetDirAntenna()->CheckAntennaMode();
+        if (m_XnodeMode == 1 && m_YnodeMode == 0) // 1--Receiver; 0--Transmitter
+        {
+            m_Rxorientation = m_thzDA->CheckRxOrientation(); // turning sector by sector
+        }
+        if (m_XnodeMode == 0 && m_YnodeMode == 1)
+        {
+            m_Rxorientation = itt->first->GetDirAntenna()->CheckRxOrientation();
+        }
+        if (m_XnodeMode == 2 && m_YnodeMode == 2)
+        {
+            m_Rxorientation = 0;
+        }
+        m_totalGain = itt->first->GetDirAntenna()->GetAntennaGain(azimuthXY,
+                                                                  azimuthYX,
+                                                                  m_XnodeMode,
+                                                                  m_YnodeMode,
+                                                                  m_Rxorientation,
+                                                                  elevationXY);
+        if (entry && geometryValid && entry->txPsd == txParams->txPsd &&
+            entry->coefficients == coefficients)
+        {
+            m_linkCacheHits++;
+            m_rxPathGain.push_back(entry->pathGain);
+        }
+        else
+        {
+            if (entry)
             {
-                m_Rxorientation = 0;
+                m_linkCacheMisses++;
             }
-            m_totalGain = itt->first->GetDirAntenna()->GetAntennaGain(XnodeMobility,
-                                                                      YnodeMobility,
-                                                                      m_XnodeMode,
-                                                                      m_YnodeMode,
-                                                                      m_Rxorientation);
-            double rxPower = m_loss->CalcRxPowerDA(txParams, XnodeMobility, YnodeMobility, m_totalGain);
-            NS_LOG_DEBUG("node " << it->first->GetNode()->GetId()
-                                 << "->" << itt->first->GetNode()->GetId()
-                                 << ", txPower = " << txParams->txPower
-                                 << " dBm, totalGain = " << m_totalGain + 30
-                                 << " dBm, rxPower = " << rxPower << " dBm"
-                                 << "  now: " << Simulator::Now());
-            uint32_t dstNodeId = itt->first->GetNode()->GetId();
-            Ptr<Packet> copy = txParams->packet->Copy();
-            ne.packet = copy;
-            ne.phy = itt->second;
-            ne.rxPower = rxPower;
-            ne.txEnd = Simulator::Now() + txParams->txDuration + delay;
-            Simulator::ScheduleWithContext(dstNodeId,
-                                           delay,
-                                           &THzChannel::ReceivePacket,
-                                           this,
-                                           j,
-                                           ne);
-        }
-        j++;
+            m_missIndex.push_back(m_rxIndex.size());
+            m_missDistance.push_back(distance);
+            m_rxPathGain.push_back(0);
+        }
+        m_rxIndex.push_back(j);
+        m_rxGainDb.push_back(m_totalGain);
+        m_rxDelay.push_back(delay);
+        m_rxEntry.push_back(entry);
+    }
+    m_loss->CalcPathGainBatch(txParams, m_missDistance, m_missPathGain, m_pool);
+    for (std::size_t q = 0; q < m_missIndex.size(); q++)
+    {
+        std::size_t k = m_missIndex[q];
+        m_rxPathGain[k] = m_missPathGain[q];
+        if (m_rxEntry[k])
+        {
+            m_rxEntry[k]->pathGain = m_missPathGain[q];
+            m_rxEntry[k]->txPsd = txParams->txPsd;
+            m_rxEntry[k]->coefficients = coefficients;
+        }
+    }
+
+    for (std::size_t k = 0; k < m_rxIndex.size(); k++)
+    {
+        uint32_t i = m_rxIndex[k];
+        double rxPower = m_loss->CalcRxPowerDbm(m_rxPathGain[k], m_rxGainDb[k]);
+        NS_LOG_DEBUG("node " << it->first->GetNode()->GetId()
+                             << "->" << m_devList[i].first->GetNode()->GetId()
+                             << ", txPower = " << txParams->txPower
+                             << " dBm, totalGain = " << m_rxGainDb[k] + 30
+                             << " dBm, rxPower = " << rxPower << " dBm"
+                             << "  now: " << Simulator::Now());
+        ne.phy = m_devList[i].second;
+        ne.rxPower = rxPower;
+        ne.txEnd = Simulator::Now() + txParams->txDuration + m_rxDelay[k];
+        uint32_t dstNodeId = m_devList[i].first->GetNode()->GetId();
+        Simulator::ScheduleWithContext(dstNodeId,
+                                       m_rxDelay[k],
+                                       &THzChannel::ReceivePacket,
+                                       this,
+                                       i,
+                                       ne);
     }
     return true;
 }
 
+void
+THzChannel::TrackCourseChanges()
+{
+    NS_LOG_FUNCTION(this);
+    while (m_tracked.size() < m_devList.size())
+    {
+        Ptr<MobilityModel> mobility =
+            m_devList[m_tracked.size()].first->GetNode()->GetObject<MobilityModel>();
+        NS_ASSERT_MSG(mobility,
+                      "THzChannel: SpatialIndex and LinkCache require a MobilityModel on every node");
+        mobility->TraceConnect("CourseChange",
+                               std::to_string(m_tracked.size()),
+                               MakeCallback(&THzChannel::CourseChanged, this));
+        m_tracked.push_back(mobility);
+        m_epoch.push_back(0);
+        m_devMobile.push_back(IsMoving(mobility));
+    }
+}
+
+void
+THzChannel::UntrackCourseChanges()
+{
+    NS_LOG_FUNCTION(this);
+    for (uint32_t i = 0; i < m_tracked.size(); i++)
+    {
+        m_tracked[i]->TraceDisconnect("CourseChange",
+                                      std::to_string(i),
+                                      MakeCallback(&THzChannel::CourseChanged, this));
+    }
+    m_tracked.clear();
+}
+
+bool
+THzChannel::IsMoving(Ptr<const MobilityModel> mobility) const
+{
+    Vector velocity = mobility->GetVelocity();
+    return velocity.x != 0 || velocity.y != 0 || velocity.z != 0;
+}
+
+void
+THzChannel::BuildSpatialIndex()
+{
+    NS_LOG_FUNCTION(this);
+    TrackCourseChanges();
+
+    m_grid.clear();
+    m_mobileDevs.clear();
+    m_devCell.assign(m_devList.size(), 0);
+    for (uint32_t i = 0; i < m_devList.size(); i++)
+    {
+        InsertSpatialIndex(i, m_devList[i].first->GetNode()->GetObject<MobilityModel>());
+    }
+    m_spatialIndexValid = true;
+    NS_LOG_INFO("Spatial index: " << m_grid.size() << " occupied cells, " << m_mobileDevs.size()
+                                  << " moving devices");
+}
+
+void
+THzChannel::UpdateMaxGain()
+{
+    // every device can be both the receiving and the transmitting side of GetAntennaGain
+    double maxGainDb = 0;
+    for (THzDeviceList::const_iterator it = m_devList.begin(); it != m_devList.end(); it++)
+    {
+        maxGainDb = std::max(maxGainDb, 2 * it->first->GetDirAntenna()->GetMaxGain());
+    }
+    if (maxGainDb != m_maxGainDb)
+    {
+        NS_LOG_INFO("Spatial index: max gain " << maxGainDb << " dB");
+        m_maxGainDb = maxGainDb;
+    }
+}
+
+uint64_t
+THzChannel::GetCellKey(int64_t ix, int64_t iy) const
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) |
+           static_cast<uint32_t>(iy);
+}
+
+uint64_t
+THzChannel::GetLinkKey(uint32_t tx, uint32_t rx) const
+{
+    return (static_cast<uint64_t>(tx) << 32) | rx;
+}
+
+void
+THzChannel::InsertSpatialIndex(uint32_t i, Ptr<const MobilityModel> mobility)
+{
+    if (m_devMobile[i])
+    {
+        // the position of a moving node changes without notification, never cull it
+        m_mobileDevs.push_back(i);
+        return;
+    }
+    Vector pos = mobility->GetPosition();
+    uint64_t key = GetCellKey(std::floor(pos.x / m_cellSize), std::floor(pos.y / m_cellSize));
+    m_devCell[i] = key;
+    m_grid[key].push_back(i);
+}
+
+void
+THzChannel::RemoveSpatialIndex(uint32_t i)
+{
+    std::vector<uint32_t>& list = m_devMobile[i] ? m_mobileDevs : m_grid[m_devCell[i]];
+    std::vector<uint32_t>::iterator it = std::find(list.begin(), list.end(), i);
+    NS_ASSERT(it != list.end());
+    *it = list.back();
+    list.pop_back();
+    if (!m_devMobile[i] && list.empty())
+    {
+        m_grid.erase(m_devCell[i]);
+    }
+}
+
+void
+THzChannel::CourseChanged(std::string context, Ptr<const MobilityModel> mobility)
+{
+    uint32_t i = std::stoul(context);
+    NS_LOG_FUNCTION(this << i << mobility->GetPosition());
+    if (i >= m_epoch.size())
+    {
+        return;
+    }
+    m_epoch[i]++; // invalidates the cached links of this device
+    bool indexed = m_spatialIndexValid && i < m_devCell.size();
+    if (indexed)
+    {
+        RemoveSpatialIndex(i);
+    }
+    m_devMobile[i] = IsMoving(mobility);
+    if (indexed)
+    {
+        InsertSpatialIndex(i, mobility);
+    }
+}
+
+void
+THzChannel::NotifyRxSpectrumModelChanged()
+{
+    m_bandsValid = false;
+}
+
+void
+THzChannel::BuildBandPartition()
+{
+    NS_LOG_FUNCTION(this);
+    m_bandModels.clear();
+    m_bandIndex.clear();
+    m_bandOverlap.clear();
+    m_bandMembers.clear();
+    m_bandMembersValid.clear();
+    m_devBand.assign(m_devList.size(), -1);
+    for (uint32_t j = 0; j < m_devList.size(); j++)
+    {
+        Ptr<const SpectrumModel> model = m_devList[j].second->GetRxSpectrumModel();
+        if (model)
+        {
+            m_devBand[j] = GetBandIndex(model);
+        }
+    }
+    m_bandsValid = true;
+    NS_LOG_INFO("Band partitioning: " << m_bandModels.size() << " spectrum models");
+}
+
+uint32_t
+THzChannel::GetBandIndex(Ptr<const SpectrumModel> model)
+{
+    std::map<SpectrumModelUid_t, uint32_t>::const_iterator it = m_bandIndex.find(model->GetUid());
+    if (it != m_bandIndex.end())
+    {
+        return it->second;
+    }
+    uint32_t b = m_bandModels.size();
+    m_bandIndex[model->GetUid()] = b;
+    m_bandModels.push_back(model);
+    m_bandOverlap.push_back(std::vector<bool>(b + 1));
+    for (uint32_t a = 0; a <= b; a++)
+    {
+        bool overlap = IsOverlapping(m_bandModels[a], model);
+        m_bandOverlap[b][a] = overlap;
+        if (a < b)
+        {
+            m_bandOverlap[a].push_back(overlap);
+        }
+    }
+    m_bandMembers.push_back(std::vector<uint32_t>());
+    m_bandMembersValid.push_back(false);
+    return b;
+}
+
+const std::vector<uint32_t>&
+THzChannel::GetBandMembers(uint32_t band)
+{
+    if (!m_bandMembersValid[band])
+    {
+        std::vector<uint32_t>& members = m_bandMembers[band];
+        members.clear();
+        for (uint32_t j = 0; j < m_devBand.size(); j++)
+        {
+            if (m_devBand[j] < 0 || m_bandOverlap[band][m_devBand[j]])
+            {
+                members.push_back(j);
+            }
+        }
+        m_bandMembersValid[band] = true;
+    }
+    return m_bandMembers[band];
+}
+
+bool
+THzChannel::IsOverlapping(Ptr<const SpectrumModel> a, Ptr<const SpectrumModel> b) const
+{
+    // both band lists are in ascending order
+    Bands::const_iterator ia = a->Begin();
+    Bands::const_iterator ib = b->Begin();
+    while (ia != a->End() && ib != b->End())
+    {
+        if (ia->fh <= ib->fl)
+        {
+            ++ia;
+        }
+        else if (ib->fh <= ia->fl)
+        {
+            ++ib;
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t
+THzChannel::GetLinkCacheHits() const
+{
+    return m_linkCacheHits;
+}
+
+uint64_t
+THzChannel::GetLinkCacheMisses() const
+{
+    return m_linkCacheMisses;
+}
+
+void
+THzChannel::GetCandidateReceivers(Vector pos, double range, std::vector<uint32_t>& candidates) const
+{
+    candidates.assign(m_mobileDevs.begin(), m_mobileDevs.end());
+    // only the x-y plane is indexed, which keeps the cell search conservative in z
+    double xl = std::floor((pos.x - range) / m_cellSize);
+    double xh = std::floor((pos.x + range) / m_cellSize);
+    double yl = std::floor((pos.y - range) / m_cellSize);
+    double yh = std::floor((pos.y + range) / m_cellSize);
+    if ((xh - xl + 1) * (yh - yl + 1) > m_grid.size())
+    {
+        // the range covers more cells than are occupied, walk the occupied ones instead
+        for (std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator it = m_grid.begin();
+             it != m_grid.end();
+             ++it)
+        {
+            double ix = static_cast<int32_t>(it->first >> 32);
+            double iy = static_cast<int32_t>(it->first & 0xffffffff);
+            if (ix >= xl && ix <= xh && iy >= yl && iy <= yh)
+            {
+                candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            }
+        }
+    }
+    else
+    {
+        for (int64_t ix = xl; ix <= xh; ix++)
+        {
+            for (int64_t iy = yl; iy <= yh; iy++)
+            {
+                std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator it =
+                    m_grid.find(GetCellKey(ix, iy));
+                if (it != m_grid.end())
+                {
+                    candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+                }
+            }
+        }
+    }
+    // deliver in device order, as without the index
+    std::sort(candidates.begin(), candidates.end());
+}
+
 void
 THzChannel::SendPacketDone(Ptr<THzPhy> phy, Ptr<Packet> packet)
 {
@@ -194,7 +729,8 @@ void
 THzChannel::ReceivePacket(uint32_t i, NoiseEntry ne)
 {
     NS_LOG_FUNCTION("");
-    m_noiseEntry.push_back(ne);
+    AddNoiseEntry(i, ne);
+    m_devList[i].second->NotifyRxSignal(ne.packet, ne.rxPower, ne.txPsd);
     m_devList[i].second->ReceivePacket(ne.packet, ne.txDuration, ne.rxPower); // calls PHY
     Simulator::Schedule(ne.txDuration, &THzChannel::ReceivePacketDone, this, i, ne);
 }
@@ -204,24 +740,60 @@ THzChannel::ReceivePacketDone(uint32_t i, NoiseEntry ne)
 {
     NS_LOG_FUNCTION("");
     m_devList[i].second->ReceivePacketDone(ne.packet, ne.rxPower); // calls PHY
-    Simulator::ScheduleNow(&THzChannel::DeleteNoiseEntry, this, ne);
+    Simulator::ScheduleNow(&THzChannel::DeleteNoiseEntry, this, i, ne);
+}
+
+void
+THzChannel::AddNoiseEntry(uint32_t i, NoiseEntry& ne)
+{
+    if (m_freeSlots.empty())
+    {
+        ne.slot = m_noiseEntry.size();
+        m_noiseEntry.push_back(ne);
+    }
+    else
+    {
+        ne.slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_noiseEntry[ne.slot] = ne;
+    }
+    m_rxPowerSumW[i] += DbmToW(ne.rxPower);
+    m_nOngoingRx[i]++;
 }
 
 void
-THzChannel::DeleteNoiseEntry(NoiseEntry ne)
+THzChannel::DeleteNoiseEntry(uint32_t i, NoiseEntry ne)
 {
     NS_LOG_FUNCTION(this);
-    std::list<NoiseEntry>::iterator it = m_noiseEntry.begin();
-    for (; it != m_noiseEntry.end(); ++it)
+    if (ne.slot >= m_noiseEntry.size() || m_noiseEntry[ne.slot].packet != ne.packet ||
+        m_noiseEntry[ne.slot].phy != ne.phy)
     {
-        if (it->packet == ne.packet && it->phy == ne.phy)
-        {
-            m_noiseEntry.erase(it);
-            break;
-        }
+        return; // the channel was cleared in the meantime
+    }
+    m_noiseEntry[ne.slot].packet = 0;
+    m_noiseEntry[ne.slot].phy = 0;
+    m_freeSlots.push_back(ne.slot);
+    if (--m_nOngoingRx[i] == 0)
+    {
+        m_rxPowerSumW[i] = 0; // drop the rounding error accumulated by the running sum
+    }
+    else
+    {
+        m_rxPowerSumW[i] -= DbmToW(ne.rxPower);
     }
 }
 
+double
+THzChannel::GetRxPowerSumW(Ptr<THzPhy> phy) const
+{
+    std::map<Ptr<THzPhy>, uint32_t>::const_iterator it = m_phyIndex.find(phy);
+    if (it == m_phyIndex.end())
+    {
+        return 0;
+    }
+    return m_rxPowerSumW[it->second];
+}
+
 double
 THzChannel::GetNoiseW(double interference)
 {
@@ -230,6 +802,12 @@ THzChannel::GetNoiseW(double interference)
     return noiseW;
 }
 
+Ptr<THzSpectrumPropagationLoss>
+THzChannel::GetPropagationLossModel() const
+{
+    return m_loss;
+}
+
 double
 THzChannel::DbmToW(double dbm)
 {
@@ -27,15 +27,20 @@
 #include "thz-net-device.h"
 #include "thz-phy.h"
 #include "thz-spectrum-signal-parameters.h"
+#include "thz-worker-pool.h"
 
 #include "ns3/channel.h"
 #include "ns3/mac48-address.h"
 #include "ns3/packet.h"
 #include "ns3/propagation-delay-model.h"
 #include "ns3/simulator.h"
+#include "ns3/spectrum-model.h"
 #include "ns3/thz-spectrum-propagation-loss.h"
 
 #include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ns3
@@ -69,8 +74,29 @@ class THzChannel : public Channel
         Time txDuration;    //!< Transmission time for the packet
         Time txEnd;         //!< time when packet transmission finished
         double_t rxPower;
+        Ptr<const SpectrumValue> txPsd; //!< transmit PSD of the packet
+        uint32_t slot;      //!< slot of the entry in m_noiseEntry while it is active
     } NoiseEntry;
 
+    /**
+     * Cached geometry and path gain of an ordered (transmitter, receiver) device pair.
+     */
+    typedef struct
+    {
+        uint32_t txEpoch;               //!< course change count of the transmitter when cached
+        uint32_t rxEpoch;               //!< course change count of the receiver when cached
+        Ptr<const SpectrumValue> txPsd; //!< transmit PSD of pathGain, null if not computed yet
+        Ptr<const THzBandCoefficients> coefficients; //!< band coefficients of pathGain
+        double distance;                //!< distance between the devices (m)
+        double azimuthXY;               //!< azimuth of the direction from transmitter to receiver
+        double azimuthYX;               //!< azimuth of the direction from receiver to transmitter
+        double elevationXY;             //!< elevation of the direction from transmitter to receiver
+        Time delay;                     //!< propagation delay
+        double pathGain;                //!< received power at 0 dB antenna gain (W)
+    } LinkEntry;
+
+    typedef std::unordered_map<uint64_t, LinkEntry> LinkCache;
+
   public:
     /**
      * Create a THzChannel
@@ -111,6 +137,25 @@ class THzChannel : public Channel
      */
     double GetNoiseW(double interference);
 
+    /**
+     * \brief get the total power of the signals currently arriving at a PHY.
+     *
+     * \param phy the receiving PHY.
+     *
+     * \return the sum of the received power of every ongoing reception at phy, unit in Watt.
+     *
+     * Subtracting the power of the signal being decoded gives its interference, without the PHY
+     * keeping its own list of ongoing receptions.
+     */
+    double GetRxPowerSumW(Ptr<THzPhy> phy) const;
+
+    /**
+     * \brief tell the channel that the spectrum model of an attached PHY has changed.
+     *
+     * The band partition is rebuilt before the next transmission.
+     */
+    void NotifyRxSpectrumModelChanged();
+
     /**
      * \brief convert the value from dBm to Watt.
      *
@@ -118,6 +163,21 @@ class THzChannel : public Channel
      */
     double DbmToW(double dbm);
 
+    /**
+     * \return the propagation loss model attached to this channel.
+     */
+    Ptr<THzSpectrumPropagationLoss> GetPropagationLossModel() const;
+
+    /**
+     * \return the number of receptions whose geometry and path gain came from the link cache.
+     */
+    uint64_t GetLinkCacheHits() const;
+
+    /**
+     * \return the number of receptions between static devices that had to be computed.
+     */
+    uint64_t GetLinkCacheMisses() const;
+
   private:
     /**
      * \brief send packet done in terahertz channel.
@@ -149,12 +209,146 @@ class THzChannel : public Channel
      */
     void ReceivePacketDone(uint32_t i, NoiseEntry ne);
 
+    /**
+     * \brief store a noise entry in a free slot of m_noiseEntry.
+     *
+     * \param i the m_devList index of the receiver.
+     * \param ne the noise entry, its slot is set.
+     */
+    void AddNoiseEntry(uint32_t i, NoiseEntry& ne);
+
     /**
      * \brief delete the noise entry.
      *
+     * \param i the m_devList index of the receiver.
      * \param ne the noise entry.
      */
-    void DeleteNoiseEntry(NoiseEntry ne);
+    void DeleteNoiseEntry(uint32_t i, NoiseEntry ne);
+
+    /**
+     * \brief subscribe to the course changes of the devices added since the last call.
+     */
+    void TrackCourseChanges();
+
+    /**
+     * \param mobility the mobility model of a device.
+     *
+     * \return true if the device has a non-zero velocity.
+     */
+    bool IsMoving(Ptr<const MobilityModel> mobility) const;
+
+    /**
+     * \brief place every device in the spatial index.
+     */
+    void BuildSpatialIndex();
+
+    /**
+     * \brief update m_maxGainDb from the current settings of every antenna.
+     *
+     * The antenna gains can change at any time through the antenna setters and attributes, so
+     * the bound is refreshed before every transmission that uses the spatial index.
+     */
+    void UpdateMaxGain();
+
+    /**
+     * \brief set the WorkerThreads attribute and start the worker pool it needs.
+     *
+     * \param workerThreads the number of threads, including the simulation thread.
+     */
+    void SetWorkerThreads(uint32_t workerThreads);
+
+    /**
+     * \return the WorkerThreads attribute.
+     */
+    uint32_t GetWorkerThreads() const;
+
+    /**
+     * \brief disconnect the CourseChange traces connected by TrackCourseChanges.
+     *
+     * The mobility models are those held since they were connected, so the traces are
+     * disconnected even when the devices already dropped their node.
+     */
+    void UntrackCourseChanges();
+
+    /**
+     * \brief register the spectrum model of every device and compute their overlap.
+     */
+    void BuildBandPartition();
+
+    /**
+     * \param model a spectrum model.
+     *
+     * \return the index of the model in the overlap matrix, registering it on first use.
+     */
+    uint32_t GetBandIndex(Ptr<const SpectrumModel> model);
+
+    /**
+     * \param band the index of a spectrum model in the overlap matrix.
+     *
+     * \return the m_devList indices of the devices whose band overlaps it, in ascending order.
+     * Devices whose spectrum model is not known yet are always included.
+     */
+    const std::vector<uint32_t>& GetBandMembers(uint32_t band);
+
+    /**
+     * \param a a spectrum model.
+     * \param b another spectrum model.
+     *
+     * \return true if a band of a and a band of b share some frequencies.
+     */
+    bool IsOverlapping(Ptr<const SpectrumModel> a, Ptr<const SpectrumModel> b) const;
+
+    /**
+     * \param tx the index of the transmitting device in m_devList.
+     * \param rx the index of the receiving device in m_devList.
+     *
+     * \return the key of the device pair in the link cache.
+     */
+    uint64_t GetLinkKey(uint32_t tx, uint32_t rx) const;
+
+    /**
+     * \param ix the cell index along x.
+     * \param iy the cell index along y.
+     *
+     * \return the key of the grid cell.
+     */
+    uint64_t GetCellKey(int64_t ix, int64_t iy) const;
+
+    /**
+     * \brief place a device in the grid cell of its current position.
+     *
+     * \param i the index of the device in m_devList.
+     * \param mobility the mobility model of the device.
+     *
+     * Moving devices are kept in a separate list and are never culled.
+     */
+    void InsertSpatialIndex(uint32_t i, Ptr<const MobilityModel> mobility);
+
+    /**
+     * \brief take a device out of the spatial index.
+     *
+     * \param i the index of the device in m_devList.
+     */
+    void RemoveSpatialIndex(uint32_t i);
+
+    /**
+     * \brief CourseChange trace sink, invalidates cached links and keeps the spatial index
+     * up to date.
+     *
+     * \param context the index of the device in m_devList.
+     * \param mobility the mobility model that changed.
+     */
+    void CourseChanged(std::string context, Ptr<const MobilityModel> mobility);
+
+    /**
+     * \brief collect the devices that may lie within range of a position.
+     *
+     * \param pos the position of the transmitter.
+     * \param range the maximum reception range, unit in meter.
+     * \param candidates filled with the m_devList indices of the candidates, in ascending order.
+     */
+    void GetCandidateReceivers(Vector pos, double range, std::vector<uint32_t>& candidates) const;
+
     double m_noiseFloor;
     double m_Rxorientation;
     double m_totalGain;
@@ -179,9 +373,54 @@ class THzChannel : public Channel
      */
     typedef std::vector<std::pair<Ptr<THzNetDevice>, Ptr<THzPhy>>> THzDeviceList;
     THzDeviceList m_devList;
-    std::list<NoiseEntry> m_noiseEntry;
+    std::vector<NoiseEntry> m_noiseEntry;  //!< ongoing receptions, addressed by NoiseEntry::slot
+    std::vector<uint32_t> m_freeSlots;     //!< unused slots of m_noiseEntry
+    std::vector<double> m_rxPowerSumW;     //!< total power of the ongoing receptions of each device
+    std::vector<uint32_t> m_nOngoingRx;    //!< number of ongoing receptions of each device
+
+    std::vector<uint32_t> m_rxIndex;     //!< m_devList index of each receiver of the current frame
+    std::vector<double> m_rxGainDb;      //!< total antenna gain towards each receiver (dB)
+    std::vector<Time> m_rxDelay;         //!< propagation delay to each receiver
+    std::vector<double> m_rxPathGain;    //!< path gain towards each receiver (W)
+    std::vector<LinkEntry*> m_rxEntry;   //!< link cache entry of each receiver, if any
+    std::vector<std::size_t> m_missIndex; //!< receivers whose path gain must be computed
+    std::vector<double> m_missDistance;  //!< distance to each of those receivers (m)
+    std::vector<double> m_missPathGain;  //!< computed path gain of each of those receivers (W)
+
+    std::map<Ptr<THzPhy>, uint32_t> m_phyIndex; //!< m_devList index of each PHY
+
+    bool m_spatialIndexEnabled; //!< deliver only to devices within reception range
+    bool m_spatialIndexValid;   //!< false until the index is built and after a device is added
+    double m_cellSize;          //!< side length of the grid cells (m)
+    std::vector<Ptr<MobilityModel>> m_tracked; //!< mobility of each device with a connected trace
+    double m_maxGainDb;         //!< largest total antenna gain of any device pair (dB)
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_grid; //!< devices in each x-y cell
+    std::vector<uint64_t> m_devCell;    //!< grid cell of each device
+    std::vector<bool> m_devMobile;      //!< true for devices with a non-zero velocity
+    std::vector<uint32_t> m_mobileDevs; //!< devices that are never culled
+    std::vector<uint32_t> m_candidates; //!< candidate receivers of the current frame
+
+    bool m_linkCacheEnabled;        //!< cache the geometry and path gain of static device pairs
+    LinkCache m_linkCache;          //!< cached links keyed by (transmitter, receiver) index
+    std::vector<uint32_t> m_epoch;  //!< course change count of each device
+    uint64_t m_linkCacheHits;       //!< receptions served from the link cache
+    uint64_t m_linkCacheMisses;     //!< receptions between static devices computed anew
+
+
+    uint32_t m_workerThreads;  //!< threads computing the path gains of a transmission
+    Ptr<THzWorkerPool> m_pool; //!< worker pool, created when m_workerThreads > 1
+
+    bool m_bandPartitioning; //!< deliver only to PHYs whose band overlaps the transmitted one
+    bool m_bandsValid;       //!< false until the partition is built and after a band changes
+    std::vector<Ptr<const SpectrumModel>> m_bandModels;     //!< known spectrum models
+    std::map<SpectrumModelUid_t, uint32_t> m_bandIndex;     //!< index of each known model
+    std::vector<std::vector<bool>> m_bandOverlap;           //!< overlap matrix of the models
+    std::vector<std::vector<uint32_t>> m_bandMembers;       //!< devices overlapping each model
+    std::vector<bool> m_bandMembersValid;                   //!< m_bandMembers entry is built
+    std::vector<int32_t> m_devBand; //!< model index of each device, -1 if not known yet
 
   protected:
+    void DoDispose() override;
 };
 
 } // namespace ns3
@@ -0,0 +1,347 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "thz-codebook-antenna.h"
+
+#include <ns3/double.h>
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+NS_LOG_COMPONENT_DEFINE("THzCodebookAntenna");
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED(THzCodebookAntenna);
+
+namespace
+{
+
+/**
+ * \param azimuth an azimuth in radians.
+ *
+ * \return the same direction within [-pi, pi].
+ */
+double
+WrapAzimuth(double azimuth)
+{
+    while (azimuth < -M_PI)
+    {
+        azimuth += M_PI + M_PI;
+    }
+    while (azimuth > M_PI)
+    {
+        azimuth -= M_PI + M_PI;
+    }
+    return azimuth;
+}
+
+/**
+ * \param delta the azimuth off the steering direction of the beam in radians.
+ * \param nElements the number of elements of the array.
+ * \param elementGain the gain of one element at its boresight (dB).
+ *
+ * \return the gain of a uniform linear array of half-wavelength spaced elements facing the
+ * steering direction [dB], floored 100 dB below its peak.
+ */
+double
+CalcBeamGainDb(double delta, uint32_t nElements, double elementGain)
+{
+    double psi = M_PI * std::sin(delta);
+    double arrayFactor = 1.0;
+    if (std::fabs(std::sin(psi / 2.0)) > 1e-12)
+    {
+        arrayFactor = std::sin(nElements * psi / 2.0) / (nElements * std::sin(psi / 2.0));
+    }
+    double power = arrayFactor * arrayFactor * std::max(std::cos(delta), 0.0);
+    return elementGain + 10 * std::log10(nElements) + 10 * std::log10(std::max(power, 1e-10));
+}
+
+/**
+ * \param table filled with the gains of a level, beam index varying fastest.
+ * \param nBeams the number of beams of the level, steered at evenly spaced azimuths.
+ * \param nElements the number of elements forming each beam.
+ * \param elementGain the gain of one element (dB).
+ * \param nAzimuth the number of tabulated azimuths.
+ * \param step the angle between two tabulated azimuths (radians).
+ */
+void
+FillLevel(std::vector<double>& table,
+          uint32_t nBeams,
+          uint32_t nElements,
+          double elementGain,
+          uint32_t nAzimuth,
+          double step)
+{
+    table.resize(nAzimuth * nBeams);
+    for (uint32_t i = 0; i < nAzimuth; i++)
+    {
+        double azimuth = -M_PI + i * step;
+        for (uint32_t k = 0; k < nBeams; k++)
+        {
+            double steering = -M_PI + (k + 0.5) * (M_PI + M_PI) / nBeams;
+            table[i * nBeams + k] =
+                CalcBeamGainDb(WrapAzimuth(azimuth - steering), nElements, elementGain);
+        }
+    }
+}
+
+} // namespace
+
+double
+THzCodebook::GetGainDb(uint32_t beam, double azimuth) const
+{
+    NS_ASSERT(beam < nBeams);
+    double x = (WrapAzimuth(azimuth) + M_PI) / step;
+    uint32_t i = std::min(static_cast<uint32_t>(x), nAzimuth - 2);
+    double frac = x - i;
+    const double* row0 = &fineGainDb[i * nBeams];
+    const double* row1 = row0 + nBeams;
+    return row0[beam] + frac * (row1[beam] - row0[beam]);
+}
+
+void
+THzCodebook::GetGainsDb(double azimuth, std::vector<double>& gainDb) const
+{
+    double x = (WrapAzimuth(azimuth) + M_PI) / step;
+    uint32_t i = std::min(static_cast<uint32_t>(x), nAzimuth - 2);
+    double frac = x - i;
+    const double* row0 = &fineGainDb[i * nBeams];
+    const double* row1 = row0 + nBeams;
+    gainDb.resize(nBeams);
+    for (uint32_t k = 0; k < nBeams; k++)
+    {
+        gainDb[k] = row0[k] + frac * (row1[k] - row0[k]);
+    }
+}
+
+uint32_t
+THzCodebook::FindBest(const std::vector<double>& table,
+                      uint32_t n,
+                      double azimuth,
+                      uint32_t first,
+                      uint32_t last) const
+{
+    double x = (WrapAzimuth(azimuth) + M_PI) / step;
+    uint32_t i = std::min(static_cast<uint32_t>(x), nAzimuth - 2);
+    double frac = x - i;
+    const double* row0 = &table[i * n];
+    const double* row1 = row0 + n;
+    uint32_t best = first;
+    double bestGain = row0[first] + frac * (row1[first] - row0[first]);
+    for (uint32_t k = first + 1; k < last; k++)
+    {
+        double gain = row0[k] + frac * (row1[k] - row0[k]);
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            best = k;
+        }
+    }
+    return best;
+}
+
+uint32_t
+THzCodebook::SearchBestBeam(double azimuth) const
+{
+    uint32_t perCoarse = nBeams / nCoarse;
+    uint32_t coarse = FindBest(coarseGainDb, nCoarse, azimuth, 0, nCoarse);
+    return FindBest(fineGainDb, nBeams, azimuth, coarse * perCoarse, (coarse + 1) * perCoarse);
+}
+
+TypeId
+THzCodebookAntenna::GetTypeId(void)
+{
+    static TypeId tid =
+        TypeId("ns3::THzCodebookAntenna")
+            .SetParent<THzDirectionalAntenna>()
+            .AddConstructor<THzCodebookAntenna>()
+            .AddAttribute("NumBeams",
+                          "Number of beams of the codebook, steered at evenly spaced azimuths",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&THzCodebookAntenna::m_nBeams),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("NumCoarseBeams",
+                          "Number of wide beams of the first level of the beam search, a divisor of NumBeams",
+                          UintegerValue(8),
+                          MakeUintegerAccessor(&THzCodebookAntenna::m_nCoarse),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("NumElements",
+                          "Number of elements of the array forming each beam",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&THzCodebookAntenna::m_nElements),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ElementGain",
+                          "The gain (dB) of one array element at its boresight",
+                          DoubleValue(5.0),
+                          MakeDoubleAccessor(&THzCodebookAntenna::m_elementGain),
+                          MakeDoubleChecker<double>())
+            .AddAttribute("CodebookResolution",
+                          "Angle between two azimuths the beam gains are tabulated at (degrees)",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&THzCodebookAntenna::m_resolution),
+                          MakeDoubleChecker<double>(0.01, 90));
+    return tid;
+}
+
+THzCodebookAntenna::THzCodebookAntenna()
+    : m_nBeams(64),
+      m_nCoarse(8),
+      m_nElements(16),
+      m_elementGain(5.0),
+      m_resolution(0.5),
+      m_rxBeam(-1)
+{
+}
+
+THzCodebookAntenna::~THzCodebookAntenna()
+{
+}
+
+Ptr<const THzCodebook>
+THzCodebookAntenna::GetCodebook() const
+{
+    if (m_codebook && m_codebook->nBeams == m_nBeams && m_codebook->nCoarse == m_nCoarse &&
+        m_codebook->nElements == m_nElements && m_codebook->elementGain == m_elementGain &&
+        m_codebook->resolution == m_resolution)
+    {
+        return m_codebook;
+    }
+    if (m_nBeams % m_nCoarse != 0)
+    {
+        NS_FATAL_ERROR("THzCodebookAntenna: NumCoarseBeams " << m_nCoarse
+                                                             << " does not divide NumBeams "
+                                                             << m_nBeams);
+    }
+    typedef std::tuple<uint32_t, uint32_t, uint32_t, double, double> CodebookKey;
+    static std::map<CodebookKey, Ptr<const THzCodebook>> codebooks;
+    CodebookKey key(m_nBeams, m_nCoarse, m_nElements, m_elementGain, m_resolution);
+    auto it = codebooks.find(key);
+    if (it == codebooks.end())
+    {
+        NS_LOG_FUNCTION("building codebook, " << m_nBeams << " beams " << m_nCoarse
+                                              << " coarse beams " << m_nElements << " elements");
+        Ptr<THzCodebook> codebook = Create<THzCodebook>();
+        uint32_t n = std::ceil(360.0 / m_resolution);
+        codebook->nBeams = m_nBeams;
+        codebook->nCoarse = m_nCoarse;
+        codebook->nElements = m_nElements;
+        codebook->elementGain = m_elementGain;
+        codebook->resolution = m_resolution;
+        codebook->nAzimuth = n + 1;
+        codebook->step = (M_PI + M_PI) / n;
+        FillLevel(codebook->fineGainDb,
+                  m_nBeams,
+                  m_nElements,
+                  m_elementGain,
+                  codebook->nAzimuth,
+                  codebook->step);
+        codebook->peakGainDb =
+            *std::max_element(codebook->fineGainDb.begin(), codebook->fineGainDb.end());
+        // a subarray with as many elements per coarse beam as the full array has per beam
+        uint32_t coarseElements =
+            std::max<uint32_t>(1, std::lround(double(m_nElements) * m_nCoarse / m_nBeams));
+        FillLevel(codebook->coarseGainDb,
+                  m_nCoarse,
+                  coarseElements,
+                  m_elementGain,
+                  codebook->nAzimuth,
+                  codebook->step);
+        it = codebooks.emplace(key, codebook).first;
+    }
+    m_codebook = it->second;
+    return m_codebook;
+}
+
+double
+THzCodebookAntenna::GetMaxGain() const
+{
+    double maxGain = GetCodebook()->peakGainDb;
+    NS_LOG_FUNCTION(this << maxGain);
+    return maxGain;
+}
+
+uint32_t
+THzCodebookAntenna::SearchBestBeam(double azimuth)
+{
+    return GetCodebook()->SearchBestBeam(azimuth);
+}
+
+void
+THzCodebookAntenna::SetRxBeam(int32_t beam)
+{
+    NS_ASSERT(beam < static_cast<int32_t>(m_nBeams));
+    m_rxBeam = beam;
+}
+
+int32_t
+THzCodebookAntenna::GetRxBeam() const
+{
+    return m_rxBeam;
+}
+
+double
+THzCodebookAntenna::GetAntennaGain(double azimuthXY,
+                                   double azimuthYX,
+                                   bool XnodeMode,
+                                   bool YnodeMode,
+                                   double RxorientationRadians,
+                                   double elevationXY)
+{
+    double rxAzimuth;
+    double txAzimuth;
+    if (XnodeMode == 1 && YnodeMode == 0) // (1--Directional Receiver; 0--Directional Transmitter)
+    {
+        rxAzimuth = azimuthXY;
+        txAzimuth = azimuthYX;
+    }
+    else if (XnodeMode == 0 && YnodeMode == 1)
+    {
+        rxAzimuth = azimuthYX;
+        txAzimuth = azimuthXY;
+    }
+    else
+    {
+        return 0;
+    }
+    Ptr<const THzCodebook> codebook = GetCodebook();
+    RecTxOrientation(txAzimuth * 180.0 / M_PI);
+
+    uint32_t rxBeam = m_rxBeam;
+    if (m_rxBeam < 0)
+    {
+        // the beam steered closest to the orientation of the receiver
+        double x = (WrapAzimuth(RxorientationRadians) + M_PI) / (M_PI + M_PI) * m_nBeams;
+        rxBeam = std::min(static_cast<uint32_t>(x), m_nBeams - 1);
+    }
+    double rxGainDb = codebook->GetGainDb(rxBeam, rxAzimuth);
+    double txGainDb = codebook->GetGainDb(codebook->SearchBestBeam(txAzimuth), txAzimuth);
+    NS_LOG_DEBUG("   Rx beam " << rxBeam << " gain " << rxGainDb << " Tx gain " << txGainDb);
+    return rxGainDb + txGainDb;
+}
+
+} // namespace ns3
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#ifndef THZ_CODEBOOK_ANTENNA_H
+#define THZ_CODEBOOK_ANTENNA_H
+
+#include "thz-dir-antenna.h"
+
+#include <ns3/simple-ref-count.h>
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Two-level beamforming codebook with the gain of every beam tabulated over azimuth.
+ *
+ * The fine level holds nBeams beams steered at evenly spaced azimuths; the coarse level holds
+ * nCoarse wider beams, each covering nBeams / nCoarse consecutive fine beams. The gains of all
+ * the beams of a level at one azimuth are stored next to each other, so the candidates for a
+ * peer are evaluated in one pass over a contiguous row.
+ */
+struct THzCodebook : public SimpleRefCount<THzCodebook>
+{
+    /**
+     * \param beam the index of a fine beam.
+     * \param azimuth the azimuth of the peer in radians.
+     *
+     * \return the gain of the beam towards azimuth [dB], interpolated linearly between the two
+     * nearest tabulated azimuths.
+     */
+    double GetGainDb(uint32_t beam, double azimuth) const;
+
+    /**
+     * \param azimuth the azimuth of the peer in radians.
+     * \param gainDb filled with the gain of every fine beam towards azimuth [dB].
+     */
+    void GetGainsDb(double azimuth, std::vector<double>& gainDb) const;
+
+    /**
+     * \param azimuth the azimuth of the peer in radians.
+     *
+     * \return the fine beam of largest gain towards azimuth, found by evaluating the coarse
+     * beams and then the fine beams of the best coarse beam only.
+     */
+    uint32_t SearchBestBeam(double azimuth) const;
+
+    uint32_t nBeams;                  //!< number of fine beams
+    uint32_t nCoarse;                 //!< number of coarse beams
+    uint32_t nElements;               //!< number of elements of the array forming the fine beams
+    double elementGain;               //!< gain of one element at its boresight (dB)
+    double resolution;                //!< angle between two tabulated azimuths (degrees)
+    uint32_t nAzimuth;                //!< number of tabulated azimuths, -pi and pi included
+    double step;                      //!< angle between two tabulated azimuths (radians)
+    double peakGainDb;                //!< largest gain of the fine beams (dB)
+    std::vector<double> fineGainDb;   //!< gain of fine beam k at azimuth i at i * nBeams + k (dB)
+    std::vector<double> coarseGainDb; //!< gain of coarse beam c at azimuth i at i * nCoarse + c
+
+  private:
+    /**
+     * \param table the gains of a level.
+     * \param n the number of beams of the level.
+     * \param azimuth the azimuth of the peer in radians.
+     * \param first the first beam to evaluate.
+     * \param last one past the last beam to evaluate.
+     *
+     * \return the beam of largest interpolated gain among [first, last).
+     */
+    uint32_t FindBest(const std::vector<double>& table,
+                      uint32_t n,
+                      double azimuth,
+                      uint32_t first,
+                      uint32_t last) const;
+};
+
+/**
+ * \ingroup Terahertz Directional Antenna Models
+ *
+ * \brief Phased-array antenna with a codebook of precomputed beams.
+ *
+ * Each beam is formed by a uniform linear array of half-wavelength spaced elements facing the
+ * steering azimuth of the beam, so its gain is the array factor times the element pattern plus
+ * 10 log10 of the number of elements. The coarse beams use a subarray with as many elements per
+ * coarse beam as the fine beams have per fine beam, which makes them nBeams / nCoarse times
+ * wider. Codebooks are shared by every antenna configured alike.
+ *
+ * The antenna plugs into the channel like THzDirectionalAntenna: a receiver listens on its
+ * selected beam, or on the beam closest to its orientation if none is selected, and a
+ * transmitter uses the best beam of the codebook towards the receiver. The BeamWidth, MaxGain
+ * and 3D pattern attributes of THzDirectionalAntenna are not used by this model, and GetMaxGain
+ * returns the peak gain of the codebook, so the channel SpatialIndex range covers its beams.
+ */
+class THzCodebookAntenna : public THzDirectionalAntenna
+{
+  public:
+    THzCodebookAntenna();
+    virtual ~THzCodebookAntenna();
+    static TypeId GetTypeId(void);
+
+    using THzDirectionalAntenna::GetAntennaGain;
+
+    /**
+     * \return the codebook of the current settings, built on the first call.
+     */
+    Ptr<const THzCodebook> GetCodebook() const;
+
+    /**
+     * \param azimuth the azimuth of the peer in radians.
+     *
+     * \return the best fine beam towards the peer, e.g. for the MAC to select per destination.
+     */
+    uint32_t SearchBestBeam(double azimuth);
+
+    /**
+     * \return the largest gain of the beams of the codebook [dB].
+     */
+    double GetMaxGain() const override;
+
+    /**
+     * \param beam the fine beam the receiver listens on, or -1 to follow the Rx orientation.
+     */
+    void SetRxBeam(int32_t beam);
+
+    /**
+     * \return the fine beam selected by SetRxBeam, or -1.
+     */
+    int32_t GetRxBeam() const;
+
+    /**
+     * \param azimuthXY the azimuth of the direction from node X to node Y in radians.
+     * \param azimuthYX the azimuth of the direction from node Y to node X in radians.
+     * \param XnodeMode the operation mode of the node X.
+     * \param YnodeMode the operation mode of the node Y.
+     * \param RxorientationRadians the orientation of the receiver node in radians.
+     * \param elevationXY not used, the codebook is over azimuth only.
+     *
+     * \brief calculate the total gain between transmitter and receiver [dB] with the beams of the
+     * codebook.
+     */
+    double GetAntennaGain(double azimuthXY,
+                          double azimuthYX,
+                          bool XnodeMode,
+                          bool YnodeMode,
+                          double RxorientationRadians,
+                          double elevationXY = 0) override;
+
+  private:
+    uint32_t m_nBeams;                         //!< number of fine beams
+    uint32_t m_nCoarse;                        //!< number of coarse beams
+    uint32_t m_nElements;                      //!< number of array elements
+    double m_elementGain;                      //!< gain of one element (dB)
+    double m_resolution;                       //!< angle between two tabulated azimuths (degrees)
+    int32_t m_rxBeam;                          //!< beam selected for reception, -1 if none
+    mutable Ptr<const THzCodebook> m_codebook; //!< codebook of the current settings
+};
+
+} // namespace ns3
+
+#endif /* THZ_CODEBOOK_ANTENNA_H */
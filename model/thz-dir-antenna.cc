@@ -36,10 +36,17 @@
 #include <ns3/mobility-helper.h>
 #include <ns3/mobility-model.h>
 #include <ns3/node.h>
+#include <ns3/string.h>
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <list>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
 #include <vector>
 
 NS_LOG_COMPONENT_DEFINE("THzDirectionalAntenna");
@@ -49,6 +56,25 @@ namespace ns3
 
 NS_OBJECT_ENSURE_REGISTERED(THzDirectionalAntenna);
 
+double
+THzAntennaGainTable::GetGainDb(double phi) const
+{
+    double x = std::fabs(phi) / step;
+    std::size_t n = gainDb.size() - 1;
+    if (!interpolate)
+    {
+        std::size_t i = static_cast<std::size_t>(x + 0.5);
+        return gainDb[std::min(i, n)];
+    }
+    std::size_t i = static_cast<std::size_t>(x);
+    if (i >= n)
+    {
+        return gainDb[n];
+    }
+    double frac = x - i;
+    return gainDb[i] + frac * (gainDb[i + 1] - gainDb[i]);
+}
+
 TypeId
 THzDirectionalAntenna::GetTypeId(void)
 {
@@ -80,11 +106,86 @@ THzDirectionalAntenna::GetTypeId(void)
                           "Initial Angle of  Rx antenna",
                           DoubleValue(0.0),
                           MakeDoubleAccessor(&THzDirectionalAntenna::m_RxIniAngle),
-                          MakeDoubleChecker<double>());
+                          MakeDoubleChecker<double>())
+            .AddAttribute("GainTableResolution",
+                          "Angle between two points of the gain table (degrees), 0 to compute every gain from the pattern",
+                          DoubleValue(0.0),
+                          MakeDoubleAccessor(&THzDirectionalAntenna::m_gainTableResolution),
+                          MakeDoubleChecker<double>(0, 180))
+            .AddAttribute("GainTableInterpolation",
+                          "If true, the gain is interpolated linearly between the points of the gain table; if false, the nearest point is read",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&THzDirectionalAntenna::m_gainTableInterpolation),
+                          MakeBooleanChecker())
+            .AddAttribute("Pattern3D",
+                          "If true, the gain is read from a pattern over azimuth and elevation instead of the azimuth-only cosine pattern",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzDirectionalAntenna::m_pattern3d),
+                          MakeBooleanChecker())
+            .AddAttribute("ElevationBeamWidth",
+                          "The 3dB beamwidth in elevation of the generated 3D pattern (degrees)",
+                          DoubleValue(40),
+                          MakeDoubleAccessor(&THzDirectionalAntenna::m_elevationBeamwidthDegrees),
+                          MakeDoubleChecker<double>(0, 180))
+            .AddAttribute("Tilt",
+                          "Elevation of the boresight of the 3D pattern (degrees), e.g. -90 for a ceiling-mounted antenna facing down",
+                          DoubleValue(0),
+                          MakeDoubleAccessor(&THzDirectionalAntenna::m_tiltDegrees),
+                          MakeDoubleChecker<double>(-90, 90))
+            .AddAttribute("PatternFile",
+                          "File of \"azimuth elevation gain\" lines (degrees, degrees, dB) on a uniform grid the 3D pattern is read from; empty to generate it from BeamWidth, ElevationBeamWidth and MaxGain",
+                          StringValue(""),
+                          MakeStringAccessor(&THzDirectionalAntenna::m_patternFile),
+                          MakeStringChecker())
+            .AddAttribute("PatternResolution",
+                          "Angle between two points of the generated 3D pattern (degrees)",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&THzDirectionalAntenna::m_patternResolution),
+                          MakeDoubleChecker<double>(0.01, 90));
     return tid;
 }
 
+double
+THzAntennaPattern::GetGainDb(double phi, double theta) const
+{
+    if (theta > M_PI / 2)
+    {
+        theta = M_PI - theta;
+        phi += M_PI;
+    }
+    else if (theta < -M_PI / 2)
+    {
+        theta = -M_PI - theta;
+        phi += M_PI;
+    }
+    if (phi > M_PI)
+    {
+        phi -= M_PI + M_PI;
+    }
+    double x = (phi + M_PI) / azimuthStep;
+    double y = (theta + M_PI / 2) / elevationStep;
+    uint32_t i = std::min(static_cast<uint32_t>(x), nAzimuth - 2);
+    uint32_t j = std::min(static_cast<uint32_t>(y), nElevation - 2);
+    double fx = x - i;
+    double fy = y - j;
+    const double* g0 = &gainDb[i * nElevation + j];
+    const double* g1 = g0 + nElevation;
+    double a = g0[0] + fy * (g0[1] - g0[0]);
+    double b = g1[0] + fy * (g1[1] - g1[0]);
+    return a + fx * (b - a);
+}
+
 THzDirectionalAntenna::THzDirectionalAntenna()
+    : m_exponent(0),
+      m_phi_tx(0),
+      m_rotating(false),
+      m_rotationStart(Seconds(0)),
+      m_gainTableResolution(0),
+      m_gainTableInterpolation(true),
+      m_pattern3d(false),
+      m_elevationBeamwidthDegrees(40),
+      m_tiltDegrees(0),
+      m_patternResolution(1.0)
 {
 }
 
@@ -133,14 +234,16 @@ void
 THzDirectionalAntenna::SetMaxGain(double maxGain)
 {
     m_maxGain = maxGain;
+    m_gainTable = 0;
 }
 
 double
 THzDirectionalAntenna::GetMaxGain() const
 {
-    NS_LOG_FUNCTION(m_maxGain << " dB "
-                              << " at node: " << m_device->GetNode()->GetId());
-    return m_maxGain;
+    double maxGain = m_pattern3d ? GetPattern()->peakGainDb : m_maxGain;
+    NS_LOG_FUNCTION(maxGain << " dB "
+                            << " at node: " << m_device->GetNode()->GetId());
+    return maxGain;
 }
 
 void
@@ -149,6 +252,7 @@ THzDirectionalAntenna::SetBeamwidth(double beamwidthDegrees)
     m_beamwidthDegrees = beamwidthDegrees;
     m_beamwidthRadians = DegreesToRadians(beamwidthDegrees);
     m_exponent = -3.0 / (20 * std::log10(std::cos(m_beamwidthRadians / 4.0)));
+    m_gainTable = 0;
 }
 
 double
@@ -173,6 +277,7 @@ THzDirectionalAntenna::TuneRxOrientation(double phi_zero)
         phi_rx -= 360;
     }
     double phi_rx_rad = phi_rx * M_PI / 180.0;
+    m_rotating = false;
     m_RxorientationDegrees = phi_rx;
     m_RxorientationRadians = phi_rx_rad;
     NS_LOG_DEBUG("THzDirectionalAntenna::TuneRxOrientation: " << m_RxorientationDegrees);
@@ -181,6 +286,10 @@ THzDirectionalAntenna::TuneRxOrientation(double phi_zero)
 double
 THzDirectionalAntenna::CheckRxOrientation()
 {
+    if (m_rotating)
+    {
+        return GetRxOrientation();
+    }
     return m_RxorientationRadians;
     NS_LOG_DEBUG("THzDirectionalAntenna::CheckRxOrientation: " << RadiansToDegrees(m_RxorientationRadians));
 }
@@ -188,7 +297,8 @@ THzDirectionalAntenna::CheckRxOrientation()
 double
 THzDirectionalAntenna::GetRxOrientation()
 {
-    double phi_rx = m_RxIniAngle + m_turnSpeed * 360 * Simulator::Now().GetSeconds();
+    double phi_rx =
+        m_RxIniAngle + m_turnSpeed * 360 * (Simulator::Now() - m_rotationStart).GetSeconds();
     while (phi_rx <= -360)
     {
         phi_rx += 360;
@@ -205,25 +315,32 @@ THzDirectionalAntenna::GetRxOrientation()
     return m_RxorientationRadians;
 }
 
-double
-THzDirectionalAntenna::GetRxGainDb(Ptr<MobilityModel> senderMobility, Ptr<MobilityModel> recvMobility)
+void
+THzDirectionalAntenna::StartRxRotation(double phi_zero)
 {
-    Angles rxAngles(senderMobility->GetPosition(), recvMobility->GetPosition());
-    double phi_rx = rxAngles.GetAzimuth() - m_RxorientationRadians;
-    while (phi_rx <= -M_PI)
-    {
-        phi_rx += M_PI + M_PI;
-    }
-    while (phi_rx > M_PI)
+    NS_LOG_FUNCTION(phi_zero << " degrees at " << Simulator::Now());
+    m_RxIniAngle = phi_zero;
+    m_rotationStart = Simulator::Now();
+    m_rotating = true;
+}
+
+void
+THzDirectionalAntenna::StopRxRotation()
+{
+    if (m_rotating)
     {
-        phi_rx -= M_PI + M_PI;
+        GetRxOrientation(); // keep the orientation reached so far
+        m_rotating = false;
     }
-    double ef = std::pow(std::cos(phi_rx / 2.0), m_exponent);
-    double m_rxgainDb = 20 * std::log10(ef);
-    NS_LOG_FUNCTION("   GetRxGainDb " << m_rxgainDb + m_maxGain);
+}
 
-    m_RxGain = m_rxgainDb + m_maxGain;
-    return m_rxgainDb + m_maxGain;
+double
+THzDirectionalAntenna::GetRxGainDb(Ptr<MobilityModel> senderMobility, Ptr<MobilityModel> recvMobility)
+{
+    Angles rxAngles(senderMobility->GetPosition(), recvMobility->GetPosition());
+    m_RxGain = CalcRxGainDb(rxAngles.GetAzimuth(), M_PI / 2 - rxAngles.GetInclination());
+    NS_LOG_FUNCTION("   GetRxGainDb " << m_RxGain);
+    return m_RxGain;
 }
 
 //----------------------------------------- TX DA ---------------------------------------//
@@ -243,13 +360,9 @@ THzDirectionalAntenna::GetTxGainDb(Ptr<MobilityModel> senderMobility, Ptr<Mobili
     }
     m_TxorientationDegrees = phi_tx * 180.0 / M_PI;
     m_TxorientationRadians = phi_tx;
-    // element factor: amplitude gain of a single antenna element in linear units
-    double ef = std::pow(std::cos(phi_tx / 2.0), m_exponent);
-    double gainDb = 20 * std::log10(ef);
-    NS_LOG_FUNCTION("   GetTxGainDb " << gainDb + m_maxGain);
-
-    m_TxGain = gainDb + m_maxGain;
-    return gainDb + m_maxGain;
+    m_TxGain = CalcGainDb(phi_tx);
+    NS_LOG_FUNCTION("   GetTxGainDb " << m_TxGain);
+    return m_TxGain;
 }
 
 //----------------------------------------- TOTAL DA GAIN -------------------------------//
@@ -265,29 +378,34 @@ THzDirectionalAntenna::GetAntennaGain(Ptr<MobilityModel> XnodeMobility,
                                        << " XnodeMode " << XnodeMode << " YnodeMode " << YnodeMode
                                        << "RecvOrientation" << RxorientationRadians * 180.0 / M_PI
                                        << " CurrentTime: " << Simulator::Now().GetSeconds());
+    Vector XnodePos = XnodeMobility->GetPosition();
+    Vector YnodePos = YnodeMobility->GetPosition();
+    Angles anglesXY(YnodePos, XnodePos);
+    return GetAntennaGain(anglesXY.GetAzimuth(),
+                          Angles(XnodePos, YnodePos).GetAzimuth(),
+                          XnodeMode,
+                          YnodeMode,
+                          RxorientationRadians,
+                          M_PI / 2 - anglesXY.GetInclination());
+}
+
+double
+THzDirectionalAntenna::GetAntennaGain(double azimuthXY,
+                                      double azimuthYX,
+                                      bool XnodeMode,
+                                      bool YnodeMode,
+                                      double RxorientationRadians,
+                                      double elevationXY)
+{
     m_RxorientationRadians = RxorientationRadians;
     if (XnodeMode == 1 && YnodeMode == 0) // (1--Directional Receiver; 0--Directional Transmitter)
     {
-        Angles rxAngles(YnodeMobility->GetPosition(), XnodeMobility->GetPosition());
-        double phi_rx = rxAngles.GetAzimuth() - m_RxorientationRadians;
-        while (phi_rx <= -M_PI)
-        {
-            phi_rx += M_PI + M_PI;
-        }
-        while (phi_rx > M_PI)
-        {
-            phi_rx -= M_PI + M_PI;
-        }
-        double ef_rx = std::pow(std::cos(phi_rx / 2.0), m_exponent);
-        double m_rxgainDb = 20 * std::log10(ef_rx);
-        NS_LOG_DEBUG("   GetRxGainDb " << m_rxgainDb + m_maxGain);
-        m_RxGain = m_rxgainDb + m_maxGain;
-        Angles txAngles(XnodeMobility->GetPosition(), YnodeMobility->GetPosition());
-        double m_TxorientationRadians = txAngles.GetAzimuth();
-        double phi_tx = txAngles.GetAzimuth() - m_TxorientationRadians;
-        Simulator::ScheduleNow(&THzDirectionalAntenna::RecTxOrientation,
-                               this,
-                               txAngles.GetAzimuth() * 180.0 / M_PI);
+        m_RxGain = CalcRxGainDb(azimuthXY, elevationXY);
+        NS_LOG_DEBUG("   GetRxGainDb " << m_RxGain);
+        double txAzimuth = azimuthYX;
+        double m_TxorientationRadians = txAzimuth;
+        double phi_tx = txAzimuth - m_TxorientationRadians;
+        RecTxOrientation(txAzimuth * 180.0 / M_PI);
         while (phi_tx <= -M_PI)
         {
             phi_tx += M_PI + M_PI;
@@ -299,35 +417,19 @@ THzDirectionalAntenna::GetAntennaGain(Ptr<MobilityModel> XnodeMobility,
         m_TxorientationDegrees = phi_tx * 180.0 / M_PI;
         m_TxorientationRadians = phi_tx;
         NS_LOG_DEBUG("1-Rx = " << m_RxorientationRadians * 180.0 / M_PI
-                               << " Tx = " << txAngles.GetAzimuth() * 180.0 / M_PI
+                               << " Tx = " << txAzimuth * 180.0 / M_PI
                                << " NOW: " << Simulator::Now());
-        double ef_tx = std::pow(std::cos(phi_tx / 2.0), m_exponent);
-        double gainDb = 20 * std::log10(ef_tx);
-        m_TxGain = gainDb + m_maxGain;
-        NS_LOG_DEBUG("   GetTxGainDb " << gainDb + m_maxGain);
+        m_TxGain = CalcGainDb(phi_tx);
+        NS_LOG_DEBUG("   GetTxGainDb " << m_TxGain);
     }
     else if (XnodeMode == 0 && YnodeMode == 1) //  (1--Directional Receiver; 0--Directional Transmitter)
     {
-        Angles rxAngles(XnodeMobility->GetPosition(), YnodeMobility->GetPosition());
-        double phi_rx = rxAngles.GetAzimuth() - m_RxorientationRadians;
-        while (phi_rx <= -M_PI)
-        {
-            phi_rx += M_PI + M_PI;
-        }
-        while (phi_rx > M_PI)
-        {
-            phi_rx -= M_PI + M_PI;
-        }
-        double ef_rx = std::pow(std::cos(phi_rx / 2.0), m_exponent);
-        double m_rxgainDb = 20 * std::log10(ef_rx);
-        NS_LOG_DEBUG("   GetRxGainDb " << m_rxgainDb + m_maxGain);
-        m_RxGain = m_rxgainDb + m_maxGain;
-        Angles txAngles(YnodeMobility->GetPosition(), XnodeMobility->GetPosition());
-        double m_TxorientationRadians = txAngles.GetAzimuth();
-        double phi_tx = txAngles.GetAzimuth() - m_TxorientationRadians;
-        Simulator::ScheduleNow(&THzDirectionalAntenna::RecTxOrientation,
-                               this,
-                               txAngles.GetAzimuth() * 180.0 / M_PI);
+        m_RxGain = CalcRxGainDb(azimuthYX, -elevationXY);
+        NS_LOG_DEBUG("   GetRxGainDb " << m_RxGain);
+        double txAzimuth = azimuthXY;
+        double m_TxorientationRadians = txAzimuth;
+        double phi_tx = txAzimuth - m_TxorientationRadians;
+        RecTxOrientation(txAzimuth * 180.0 / M_PI);
         while (phi_tx <= -M_PI)
         {
             phi_tx += M_PI + M_PI;
@@ -339,35 +441,19 @@ THzDirectionalAntenna::GetAntennaGain(Ptr<MobilityModel> XnodeMobility,
         m_TxorientationDegrees = phi_tx * 180.0 / M_PI;
         m_TxorientationRadians = phi_tx;
         NS_LOG_DEBUG("2-Rx = " << m_RxorientationRadians * 180.0 / M_PI
-                               << " Tx = " << txAngles.GetAzimuth() * 180.0 / M_PI
+                               << " Tx = " << txAzimuth * 180.0 / M_PI
                                << " NOW: " << Simulator::Now());
-        double ef_tx = std::pow(std::cos(phi_tx / 2.0), m_exponent);
-        double gainDb = 20 * std::log10(ef_tx);
-        m_TxGain = gainDb + m_maxGain;
-        NS_LOG_DEBUG("   GetTxGainDb " << gainDb + m_maxGain);
+        m_TxGain = CalcGainDb(phi_tx);
+        NS_LOG_DEBUG("   GetTxGainDb " << m_TxGain);
     }
     else if (XnodeMode != 0 && XnodeMode != 1 && YnodeMode != 0 && YnodeMode != 1) //  (Omni-Directional Transmitter and receiver)
     {
-        Angles rxAngles(XnodeMobility->GetPosition(), YnodeMobility->GetPosition());
-        double phi_rx = rxAngles.GetAzimuth() - m_RxorientationRadians;
-        while (phi_rx <= -M_PI)
-        {
-            phi_rx += M_PI + M_PI;
-        }
-        while (phi_rx > M_PI)
-        {
-            phi_rx -= M_PI + M_PI;
-        }
-        double ef_rx = std::pow(std::cos(phi_rx / 2.0), m_exponent);
-        double m_rxgainDb = 20 * std::log10(ef_rx);
-        NS_LOG_DEBUG("   GetRxGainDb " << m_rxgainDb + m_maxGain);
-        m_RxGain = m_rxgainDb + m_maxGain;
-        Angles txAngles(XnodeMobility->GetPosition(), YnodeMobility->GetPosition());
-        double m_TxorientationRadians = txAngles.GetAzimuth();
-        double phi_tx = txAngles.GetAzimuth() - m_TxorientationRadians;
-        Simulator::ScheduleNow(&THzDirectionalAntenna::RecTxOrientation,
-                               this,
-                               txAngles.GetAzimuth() * 180.0 / M_PI);
+        m_RxGain = CalcRxGainDb(azimuthYX, -elevationXY);
+        NS_LOG_DEBUG("   GetRxGainDb " << m_RxGain);
+        double txAzimuth = azimuthYX;
+        double m_TxorientationRadians = txAzimuth;
+        double phi_tx = txAzimuth - m_TxorientationRadians;
+        RecTxOrientation(txAzimuth * 180.0 / M_PI);
         while (phi_tx <= -M_PI)
         {
             phi_tx += M_PI + M_PI;
@@ -378,10 +464,8 @@ THzDirectionalAntenna::GetAntennaGain(Ptr<MobilityModel> XnodeMobility,
         }
         m_TxorientationDegrees = phi_tx * 180.0 / M_PI;
         m_TxorientationRadians = phi_tx;
-        double ef_tx = std::pow(std::cos(phi_tx / 2.0), m_exponent);
-        double gainDb = 20 * std::log10(ef_tx);
-        m_TxGain = gainDb + m_maxGain;
-        NS_LOG_DEBUG("   GetTxGainDb " << gainDb + m_maxGain);
+        m_TxGain = CalcGainDb(phi_tx);
+        NS_LOG_DEBUG("   GetTxGainDb " << m_TxGain);
     }
     else
     {
@@ -391,6 +475,230 @@ THzDirectionalAntenna::GetAntennaGain(Ptr<MobilityModel> XnodeMobility,
     return m_RxGain + m_TxGain;
 }
 
+double
+THzDirectionalAntenna::CalcRxGainDb(double azimuth, double elevation)
+{
+    if (!m_pattern3d)
+    {
+        double phi = azimuth - m_RxorientationRadians;
+        while (phi <= -M_PI)
+        {
+            phi += M_PI + M_PI;
+        }
+        while (phi > M_PI)
+        {
+            phi -= M_PI + M_PI;
+        }
+        return CalcGainDb(phi);
+    }
+    // rotate the direction of the peer into the frame of the antenna: first about the vertical
+    // axis by the Rx orientation, then about the horizontal axis by the tilt, so the boresight
+    // is the x axis
+    double tilt = DegreesToRadians(m_tiltDegrees);
+    double x = std::cos(elevation) * std::cos(azimuth - m_RxorientationRadians);
+    double y = std::cos(elevation) * std::sin(azimuth - m_RxorientationRadians);
+    double z = std::sin(elevation);
+    double xb = x * std::cos(tilt) + z * std::sin(tilt);
+    double zb = z * std::cos(tilt) - x * std::sin(tilt);
+    double phi = std::atan2(y, xb);
+    double theta = std::asin(std::max(-1.0, std::min(1.0, zb)));
+    return CalcGainDb(phi, theta);
+}
+
+double
+THzDirectionalAntenna::CalcGainDb(double phi, double theta)
+{
+    if (m_pattern3d)
+    {
+        return GetPattern()->GetGainDb(phi, theta);
+    }
+    if (m_gainTableResolution > 0)
+    {
+        return GetGainTable()->GetGainDb(phi);
+    }
+    // element factor: amplitude gain of a single antenna element in linear units
+    double ef = std::pow(std::cos(phi / 2.0), m_exponent);
+    double gainDb = 20 * std::log10(ef);
+    return gainDb + m_maxGain;
+}
+
+Ptr<const THzAntennaGainTable>
+THzDirectionalAntenna::GetGainTable()
+{
+    if (m_gainTable && m_gainTable->exponent == m_exponent && m_gainTable->maxGain == m_maxGain &&
+        m_gainTable->resolution == m_gainTableResolution &&
+        m_gainTable->interpolate == m_gainTableInterpolation)
+    {
+        return m_gainTable;
+    }
+    typedef std::tuple<double, double, double, bool> GainTableKey;
+    static std::map<GainTableKey, Ptr<const THzAntennaGainTable>> tables;
+    GainTableKey key(m_exponent, m_maxGain, m_gainTableResolution, m_gainTableInterpolation);
+    auto it = tables.find(key);
+    if (it == tables.end())
+    {
+        NS_LOG_FUNCTION("building gain table, exponent " << m_exponent << " max gain "
+                                                         << m_maxGain << " dB resolution "
+                                                         << m_gainTableResolution << " degrees");
+        Ptr<THzAntennaGainTable> table = Create<THzAntennaGainTable>();
+        std::size_t n = std::ceil(180.0 / m_gainTableResolution);
+        table->exponent = m_exponent;
+        table->maxGain = m_maxGain;
+        table->resolution = m_gainTableResolution;
+        table->step = M_PI / n;
+        table->interpolate = m_gainTableInterpolation;
+        table->gainDb.resize(n + 1);
+        for (std::size_t i = 0; i <= n; i++)
+        {
+            // in logarithmic form, so that the gain stays finite towards the back lobe
+            table->gainDb[i] =
+                20 * m_exponent * std::log10(std::cos(i * table->step / 2.0)) + m_maxGain;
+        }
+        it = tables.emplace(key, table).first;
+    }
+    m_gainTable = it->second;
+    return m_gainTable;
+}
+
+Ptr<const THzAntennaPattern>
+THzDirectionalAntenna::GetPattern() const
+{
+    if (m_pattern && m_pattern->fileName == m_patternFile &&
+        (!m_patternFile.empty() ||
+         (m_pattern->exponent == m_exponent &&
+          m_pattern->elevationBeamwidth == m_elevationBeamwidthDegrees &&
+          m_pattern->maxGain == m_maxGain && m_pattern->resolution == m_patternResolution)))
+    {
+        return m_pattern;
+    }
+    typedef std::tuple<std::string, double, double, double, double> PatternKey;
+    static std::map<PatternKey, Ptr<const THzAntennaPattern>> patterns;
+    PatternKey key = m_patternFile.empty()
+                         ? PatternKey("",
+                                      m_exponent,
+                                      m_elevationBeamwidthDegrees,
+                                      m_maxGain,
+                                      m_patternResolution)
+                         : PatternKey(m_patternFile, 0, 0, 0, 0);
+    auto it = patterns.find(key);
+    if (it == patterns.end())
+    {
+        Ptr<THzAntennaPattern> pattern;
+        if (!m_patternFile.empty())
+        {
+            pattern = ReadPattern(m_patternFile);
+        }
+        else
+        {
+            NS_LOG_FUNCTION("building 3D pattern, exponent "
+                            << m_exponent << " elevation beamwidth " << m_elevationBeamwidthDegrees
+                            << " degrees max gain " << m_maxGain << " dB resolution "
+                            << m_patternResolution << " degrees");
+            double elevationBeamwidthRadians = DegreesToRadians(m_elevationBeamwidthDegrees);
+            double elevationExponent =
+                -3.0 / (20 * std::log10(std::cos(elevationBeamwidthRadians / 4.0)));
+            uint32_t n = std::ceil(180.0 / m_patternResolution);
+            pattern = Create<THzAntennaPattern>();
+            pattern->exponent = m_exponent;
+            pattern->elevationBeamwidth = m_elevationBeamwidthDegrees;
+            pattern->maxGain = m_maxGain;
+            pattern->resolution = m_patternResolution;
+            pattern->nAzimuth = 2 * n + 1;
+            pattern->nElevation = n + 1;
+            pattern->azimuthStep = M_PI / n;
+            pattern->elevationStep = M_PI / n;
+            pattern->gainDb.resize(pattern->nAzimuth * pattern->nElevation);
+            for (uint32_t i = 0; i < pattern->nAzimuth; i++)
+            {
+                double phi = -M_PI + i * pattern->azimuthStep;
+                double azimuthDb = 20 * m_exponent * std::log10(std::cos(phi / 2.0));
+                for (uint32_t j = 0; j < pattern->nElevation; j++)
+                {
+                    double theta = -M_PI / 2 + j * pattern->elevationStep;
+                    pattern->gainDb[i * pattern->nElevation + j] =
+                        azimuthDb + 20 * elevationExponent * std::log10(std::cos(theta / 2.0)) +
+                        m_maxGain;
+                }
+            }
+        }
+        pattern->peakGainDb = *std::max_element(pattern->gainDb.begin(), pattern->gainDb.end());
+        it = patterns.emplace(key, pattern).first;
+    }
+    m_pattern = it->second;
+    return m_pattern;
+}
+
+Ptr<THzAntennaPattern>
+THzDirectionalAntenna::ReadPattern(std::string fileName)
+{
+    NS_LOG_FUNCTION(fileName);
+    std::ifstream file(fileName.c_str(), std::ifstream::in);
+    if (!file.is_open())
+    {
+        NS_FATAL_ERROR("THzDirectionalAntenna: open " << fileName << " failed");
+    }
+    std::vector<double> azimuth;
+    std::vector<double> elevation;
+    std::vector<double> gain;
+    std::set<double> azimuths;
+    std::set<double> elevations;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        double az;
+        double el;
+        double g;
+        if (line.empty() || line[0] == '#' || !(iss >> az >> el >> g))
+        {
+            continue;
+        }
+        azimuth.push_back(az);
+        elevation.push_back(el);
+        gain.push_back(g);
+        azimuths.insert(az);
+        elevations.insert(el);
+    }
+    if (azimuths.size() < 2 || elevations.size() < 2 ||
+        azimuths.size() * elevations.size() != gain.size() ||
+        std::fabs(*azimuths.begin() + 180) > 1e-6 || std::fabs(*azimuths.rbegin() - 180) > 1e-6 ||
+        std::fabs(*elevations.begin() + 90) > 1e-6 || std::fabs(*elevations.rbegin() - 90) > 1e-6)
+    {
+        NS_FATAL_ERROR("THzDirectionalAntenna: "
+                       << fileName << " is not a full grid over [-180, 180] x [-90, 90] degrees");
+    }
+
+    Ptr<THzAntennaPattern> pattern = Create<THzAntennaPattern>();
+    pattern->fileName = fileName;
+    pattern->exponent = 0;
+    pattern->elevationBeamwidth = 0;
+    pattern->maxGain = 0;
+    pattern->resolution = 0;
+    pattern->nAzimuth = azimuths.size();
+    pattern->nElevation = elevations.size();
+    pattern->azimuthStep = 2 * M_PI / (pattern->nAzimuth - 1);
+    pattern->elevationStep = M_PI / (pattern->nElevation - 1);
+    pattern->gainDb.assign(pattern->nAzimuth * pattern->nElevation, NAN);
+    double azimuthStepDegrees = 360.0 / (pattern->nAzimuth - 1);
+    double elevationStepDegrees = 180.0 / (pattern->nElevation - 1);
+    for (std::size_t k = 0; k < gain.size(); k++)
+    {
+        double x = (azimuth[k] + 180) / azimuthStepDegrees;
+        double y = (elevation[k] + 90) / elevationStepDegrees;
+        uint32_t i = std::lround(x);
+        uint32_t j = std::lround(y);
+        std::size_t index = i * pattern->nElevation + j;
+        if (std::fabs(x - i) > 1e-6 || std::fabs(y - j) > 1e-6 ||
+            !std::isnan(pattern->gainDb[index]))
+        {
+            NS_FATAL_ERROR("THzDirectionalAntenna: " << fileName << " is not a uniform grid at "
+                                                     << azimuth[k] << " " << elevation[k]);
+        }
+        pattern->gainDb[index] = gain[k];
+    }
+    return pattern;
+}
+
 void
 THzDirectionalAntenna::RecTxOrientation(double phi_tx)
 {
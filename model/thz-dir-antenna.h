@@ -32,14 +32,72 @@
 #include <ns3/boolean.h>
 #include <ns3/mobility-model.h>
 #include <ns3/object.h>
+#include <ns3/simple-ref-count.h>
 #include <ns3/simulator.h>
 
 #include <cmath>
 #include <list>
+#include <string>
 #include <vector>
 
 namespace ns3
 {
+/**
+ * \brief Gain of the cosine pattern tabulated over the off-boresight angle.
+ *
+ * Holds the gain at every multiple of the angular resolution between 0 and pi, for one pattern
+ * exponent and maximum gain. The pattern is symmetric, so the absolute off-boresight angle is
+ * looked up.
+ */
+struct THzAntennaGainTable : public SimpleRefCount<THzAntennaGainTable>
+{
+    /**
+     * \param phi the off-boresight angle in radians, within [-pi, pi].
+     *
+     * \return the gain at phi [dB], interpolated linearly between the two nearest points or
+     * read at the nearest point.
+     */
+    double GetGainDb(double phi) const;
+
+    double exponent;            //!< exponent of the cosine pattern
+    double maxGain;             //!< gain at the boresight (dB)
+    double resolution;          //!< angular resolution the table was built for (degrees)
+    double step;                //!< angle between two points (radians)
+    bool interpolate;           //!< interpolate between points instead of taking the nearest
+    std::vector<double> gainDb; //!< gain at each point (dB)
+};
+
+/**
+ * \brief Gain of a 3D pattern tabulated over azimuth and elevation.
+ *
+ * Holds the gain on a uniform grid covering azimuths from -pi to pi and elevations from -pi/2 to
+ * pi/2 relative to the boresight, either read from a pattern file or generated from the cosine
+ * pattern of the azimuth and the elevation beamwidths.
+ */
+struct THzAntennaPattern : public SimpleRefCount<THzAntennaPattern>
+{
+    /**
+     * \param phi the azimuth off the boresight in radians, within [-pi, pi].
+     * \param theta the elevation off the boresight in radians, within [-pi, pi].
+     *
+     * \return the gain in that direction [dB], interpolated bilinearly between the four nearest
+     * points. Elevations beyond the poles are folded over to the opposite azimuth.
+     */
+    double GetGainDb(double phi, double theta) const;
+
+    std::string fileName;       //!< pattern file the table was read from, empty if generated
+    double exponent;            //!< exponent of the azimuth cosine pattern, if generated
+    double elevationBeamwidth;  //!< 3dB beamwidth in elevation (degrees), if generated
+    double maxGain;             //!< gain at the boresight (dB), if generated
+    double peakGainDb;          //!< largest gain of the table (dB)
+    double resolution;          //!< angular resolution the table was generated for (degrees)
+    uint32_t nAzimuth;          //!< number of azimuth points, both ends included
+    uint32_t nElevation;        //!< number of elevation points, both ends included
+    double azimuthStep;         //!< angle between two azimuth points (radians)
+    double elevationStep;       //!< angle between two elevation points (radians)
+    std::vector<double> gainDb; //!< gain at each point (dB), elevation index varying fastest
+};
+
 /**
  * \defgroup Terahertz Directional Antenna Models
  *
@@ -102,8 +160,11 @@ class THzDirectionalAntenna : public Object
 
     /**
      * \brief get the maximum gain of the directional antennas for both transmitter and receiver [dB]
+     *
+     * With Pattern3D, this is the largest gain of the 3D pattern, which for a PatternFile need
+     * not be the MaxGain attribute.
      */
-    double GetMaxGain() const;
+    virtual double GetMaxGain() const;
 
     /**
      * \param beamwidthDegree the beamwidth of the directional antenna in degrees
@@ -127,17 +188,34 @@ class THzDirectionalAntenna : public Object
     /**
      * \brief check the orientation of the receiver's directional antenna based on user setting
      *
-     * returns a orientation of sector-by-sector turing directional antenna
+     * returns a orientation of sector-by-sector turing directional antenna, or of the smoothly
+     * turning antenna while a rotation started by StartRxRotation is running
      */
     double CheckRxOrientation();
 
     /**
      * \brief check the orientation of the receiver's directional antenna based on time duration
      *
-     * returns a orientation of smoothly turing directional antenna
+     * returns a orientation of smoothly turing directional antenna, measured from the start of the
+     * last rotation
      */
     double GetRxOrientation();
 
+    /**
+     * \param phi_zero the orientation at the current time in degrees
+     *
+     * \brief turn the receiver's directional antenna continuously at the turning speed
+     *
+     * the orientation is computed from the elapsed time whenever it is checked, so the rotation
+     * needs no simulator event. It runs until StopRxRotation or TuneRxOrientation is called.
+     */
+    void StartRxRotation(double phi_zero);
+
+    /**
+     * \brief stop the rotation of the receiver's directional antenna at its current orientation
+     */
+    void StopRxRotation();
+
     /**
      * \param phi_tx the orientation of the transmitter's directional antenna
      *
@@ -147,6 +225,9 @@ class THzDirectionalAntenna : public Object
 
     /**
      * \brief check the orientation of the transmitter's directional antenna
+     *
+     * returns the azimuth in degrees towards the transmitter of the last GetAntennaGain call,
+     * recorded when the gain is computed rather than by a simulator event
      */
     double CheckTxOrientation();
 
@@ -185,7 +266,80 @@ class THzDirectionalAntenna : public Object
                           bool YnodeMode,
                           double RxorientationRadians);
 
+    /**
+     * \param azimuthXY the azimuth of the direction from node X to node Y in radians.
+     * \param azimuthYX the azimuth of the direction from node Y to node X in radians.
+     * \param XnodeMode the operation mode of the node X.
+     * \param YnodeMode the operation mode of the node Y.
+     * \param RxorientationRadians the orientation of the receiver node in radians.
+     * \param elevationXY the elevation of the direction from node X to node Y in radians, only
+     *        used by the 3D pattern.
+     *
+     * \brief calculate the total directional antenna's gain between transmitter and receiver [dB]
+     * from the azimuths of the node pair, e.g. as cached by the channel for static nodes.
+     *
+     * With Pattern3D, the receiver's gain is read from the pattern at the azimuth and elevation
+     * of the transmitter in the frame of the antenna, whose boresight is at the receiver
+     * orientation in azimuth and at the Tilt in elevation. The transmitter points its beam at the
+     * receiver in both planes.
+     */
+    virtual double GetAntennaGain(double azimuthXY,
+                                  double azimuthYX,
+                                  bool XnodeMode,
+                                  bool YnodeMode,
+                                  double RxorientationRadians,
+                                  double elevationXY = 0);
+
   private:
+    /**
+     * \param azimuth the azimuth of the direction towards the peer in radians.
+     * \param elevation the elevation of the direction towards the peer in radians.
+     *
+     * \return the receive gain towards the peer [dB]. With Pattern3D, the direction is rotated
+     * by the Rx orientation and the Tilt into the frame of the antenna before the pattern is
+     * read, so a ceiling-mounted antenna with Tilt -90 sees peers at the same angle off nadir
+     * with the same gain whatever their azimuth. Otherwise only the azimuth off the Rx
+     * orientation is used.
+     */
+    double CalcRxGainDb(double azimuth, double elevation);
+
+    /**
+     * \param phi the off-boresight angle in radians, within [-pi, pi].
+     *
+     * \param theta the elevation off the boresight in radians, within [-pi, pi].
+     *
+     * \return the gain of the antenna at phi [dB], read from the gain table if one is enabled,
+     * or from the 3D pattern at (phi, theta) with Pattern3D.
+     */
+    double CalcGainDb(double phi, double theta = 0);
+
+    /**
+     * \brief Get the gain table of the current beamwidth and maximum gain.
+     *
+     * Tables are kept in a process-wide registry keyed by the pattern exponent, the maximum gain
+     * and the table settings, so antennas configured alike share one. The table held by the
+     * antenna is checked against its current settings on every query, so it follows
+     * SetBeamwidth, SetMaxGain and the attributes.
+     */
+    Ptr<const THzAntennaGainTable> GetGainTable();
+
+    /**
+     * \brief Get the 3D pattern of the current settings.
+     *
+     * Patterns are shared through a process-wide registry like the gain tables, keyed by the
+     * pattern file, or by the beamwidths, the maximum gain and the resolution when generated.
+     */
+    Ptr<const THzAntennaPattern> GetPattern() const;
+
+    /**
+     * \param fileName the pattern file.
+     *
+     * \return the pattern read from the file, which holds one "azimuth elevation gain" line per
+     * point of a uniform grid covering [-180, 180] x [-90, 90] degrees, with lines starting with
+     * '#' ignored.
+     */
+    static Ptr<THzAntennaPattern> ReadPattern(std::string fileName);
+
     Ptr<THzNetDevice> m_device;
     Ptr<Node> m_node;
 
@@ -203,6 +357,9 @@ class THzDirectionalAntenna : public Object
     double m_phi_tx;
     double m_maxGain;
 
+    bool m_rotating;      //!< the Rx orientation follows from the time elapsed since m_rotationStart
+    Time m_rotationStart; //!< time at which the Rx antenna was at m_RxIniAngle
+
     Time m_CurrentTime;
     Time m_SectorTime;
 
@@ -217,6 +374,17 @@ class THzDirectionalAntenna : public Object
 
     double m_RxGain;
     double m_TxGain;
+
+    double m_gainTableResolution;               //!< angle between two points of the gain table (degrees)
+    bool m_gainTableInterpolation;              //!< interpolate the gain table linearly
+    Ptr<const THzAntennaGainTable> m_gainTable; //!< gain table of the current settings, if any
+
+    bool m_pattern3d;                   //!< use the 3D pattern
+    double m_elevationBeamwidthDegrees; //!< 3dB beamwidth in elevation of the generated pattern
+    double m_tiltDegrees;               //!< elevation of the boresight (degrees)
+    std::string m_patternFile;          //!< file the 3D pattern is read from, if any
+    double m_patternResolution;         //!< grid resolution of the generated pattern (degrees)
+    mutable Ptr<const THzAntennaPattern> m_pattern; //!< 3D pattern of the current settings, if any
 };
 
 } // namespace ns3
@@ -162,6 +162,11 @@ THzMacMacro::GetTypeId(void)
                           UintegerValue(5),
                           MakeUintegerAccessor(&THzMacMacro::m_dataRetryLimit),
                           MakeUintegerChecker<uint16_t>())
+            .AddAttribute("ContinuousRotation",
+                          "If true, the receiver antenna turns continuously at its TurningSpeed and its orientation is computed when needed; if false, it is turned sector by sector by a periodic event",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzMacMacro::m_continuousRotation),
+                          MakeBooleanChecker())
             .AddTraceSource("CtsTimeout",
                             "Trace Hookup for CTS Timeout",
                             MakeTraceSourceAccessor(&THzMacMacro::m_traceCtsTimeout),
@@ -429,6 +434,13 @@ THzMacMacro::SetRxAntennaParameters()
                  << " Antenna Beamwidth: " << beamwidthDegrees << " deg, TurningSpeed: "
                  << m_thzAD->GetRxTurningSpeed() << " MaxGain: " << m_thzAD->GetMaxGain() << "dB");
 
+    if (m_continuousRotation)
+    {
+        // the orientation follows from the time elapsed since now, no event is needed to turn
+        m_thzAD->StartRxRotation(m_rxIniAngle);
+        return;
+    }
+
     m_thzAD->TuneRxOrientation(m_rxIniAngle);
     m_rxIniAngle = m_rxIniAngle + beamwidthDegrees;
     while (m_rxIniAngle <= -360)
@@ -466,6 +478,7 @@ THzMacMacro::Enqueue(Ptr<Packet> packet, Mac48Address dest)
         m_pktQueue.push_back(packet);
         m_SetRxAntennaEvent.Cancel(); // WHY ??
         m_thzAD = m_device->GetDirAntenna();
+        m_thzAD->StopRxRotation();
         m_thzAD->SetAttribute("TuneRxTxMode", DoubleValue(0)); // set as transmitter
         m_thzAD->SetAttribute("InitialAngle", DoubleValue(0.0));
         double beamwidthDegrees = m_thzAD->GetBeamwidth(); // get default beamwidth
@@ -434,6 +434,7 @@ class THzMacMacro : public THzMac
 
     State m_state;
     bool m_rtsEnable;
+    bool m_continuousRotation; //!< turn the receiver antenna without periodic events
 
     Ptr<THzDirectionalAntenna> m_thzAD;
 
@@ -29,6 +29,7 @@
 #include "thz-spectrum-signal-parameters.h"
 #include "thz-spectrum-waveform.h"
 
+#include "ns3/boolean.h"
 #include "ns3/callback.h"
 #include "ns3/double.h"
 #include "ns3/log.h"
@@ -40,6 +41,8 @@
 #include "ns3/traced-value.h"
 #include "ns3/uinteger.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 NS_LOG_COMPONENT_DEFINE("THzPhyMacro");
@@ -53,7 +56,8 @@ THzPhyMacro::THzPhyMacro()
     : m_device(0),
       m_mac(0),
       m_channel(0),
-      m_pktRx(0)
+      m_pktRx(0),
+      m_frequencySelective(false)
 
 {
     m_csBusy = false;
@@ -143,7 +147,15 @@ THzPhyMacro::GetTypeId(void)
                                           "Transmission Rate (bps) for Data Packets",
                                           DoubleValue(315.52e9),
                                           MakeDoubleAccessor(&THzPhyMacro::m_dataRate64QAM),
-                                          MakeDoubleChecker<double>());
+                                          MakeDoubleChecker<double>())
+                            .AddAttribute("FrequencySelective",
+                                          "If true, the interference is accumulated band by band "
+                                          "and a packet is decoded with its effective SINR over "
+                                          "the bands, so partially overlapping signals only "
+                                          "interfere where they overlap",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&THzPhyMacro::m_frequencySelective),
+                                          MakeBooleanChecker());
     return tid;
 }
 
@@ -155,14 +167,29 @@ THzPhyMacro::CalTxPsd()
     double txPowerW = txPowerMW / 1000.0;
 
     Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
-    Ptr<SpectrumModel> InitTHzSpectrumWave;
-    Ptr<SpectrumModel> InitTHzSpectrumWaveAll;
-    InitTHzSpectrumWave = sf->THzSpectrumWaveformInitializer();
-    InitTHzSpectrumWaveAll = sf->AllTHzSpectrumWaveformInitializer();
-    m_txPsd = sf->CreateTxPowerSpectralDensity(txPowerW);
+    m_txPsd = sf->GetTxPowerSpectralDensity(txPowerW); // shared by PHYs of the same configuration
     m_numberOfSamples = sf->m_numsample;
     m_numberOfSubBands = sf->m_numsb;
     m_subBandBandwidth = sf->m_sbw;
+    // the receive bands are those of m_txPsd, the weights of the previous bands are stale
+    m_bandWeights.clear();
+    m_bandSignals.clear();
+    m_bandPowerW.assign(m_txPsd->GetValuesN(), 0.0);
+    // white noise splits over the receive bands like their bandwidths
+    Ptr<const SpectrumModel> rxModel = m_txPsd->GetSpectrumModel();
+    double totalWidth = (rxModel->End() - 1)->fh - rxModel->Begin()->fl;
+    m_bandNoiseShare.clear();
+    for (Bands::const_iterator rx = rxModel->Begin(); rx != rxModel->End(); ++rx)
+    {
+        m_bandNoiseShare.push_back(totalWidth > 0 ? (rx->fh - rx->fl) / totalWidth
+                                                  : 1.0 / rxModel->GetNumBands());
+    }
+    if (m_channel)
+    {
+        // build the per-band loss coefficients of m_txPsd once, ahead of the first transmission
+        m_channel->GetPropagationLossModel()->GetBandCoefficients(m_txPsd->GetSpectrumModel());
+        m_channel->NotifyRxSpectrumModelChanged();
+    }
 }
 
 void
@@ -227,6 +254,16 @@ THzPhyMacro::GetChannel()
     return m_channel;
 }
 
+Ptr<const SpectrumModel>
+THzPhyMacro::GetRxSpectrumModel() const
+{
+    if (!m_txPsd)
+    {
+        return 0;
+    }
+    return m_txPsd->GetSpectrumModel();
+}
+
 Mac48Address
 THzPhyMacro::GetAddress()
 {
@@ -328,12 +365,105 @@ THzPhyMacro::ReceivePacket(Ptr<Packet> packet, Time txDuration, double_t rxPower
     }
 }
 
+void
+THzPhyMacro::NotifyRxSignal(Ptr<Packet> packet, double rxPower, Ptr<const SpectrumValue> txPsd)
+{
+    if (!m_frequencySelective || !m_txPsd || !txPsd)
+    {
+        return;
+    }
+    BandSignal signal;
+    signal.weights = &GetBandWeights(txPsd);
+    signal.rxPowerW = DbmToW(rxPower);
+    const std::vector<double>& w = *signal.weights;
+    for (std::size_t b = 0; b < w.size(); b++)
+    {
+        m_bandPowerW[b] += signal.rxPowerW * w[b];
+    }
+    m_bandSignals[PeekPointer(packet)] = signal;
+}
+
+const std::vector<double>&
+THzPhyMacro::GetBandWeights(Ptr<const SpectrumValue> txPsd)
+{
+    std::map<Ptr<const SpectrumValue>, std::vector<double>>::iterator it =
+        m_bandWeights.find(txPsd);
+    if (it != m_bandWeights.end())
+    {
+        return it->second;
+    }
+    Ptr<const SpectrumModel> rxModel = m_txPsd->GetSpectrumModel();
+    std::vector<double> w(rxModel->GetNumBands(), 0.0);
+    double total = 0.0;
+    // both band lists are sorted by frequency, so one sweep attributes every transmit band
+    Bands::const_iterator rx = rxModel->Begin();
+    std::size_t b = 0;
+    uint32_t i = 0;
+    for (Bands::const_iterator tx = txPsd->ConstBandsBegin(); tx != txPsd->ConstBandsEnd();
+         ++tx, ++i)
+    {
+        double power = txPsd->ValuesAt(i);
+        total += power;
+        while (rx != rxModel->End() && rx->fh < tx->fc)
+        {
+            ++rx;
+            ++b;
+        }
+        if (rx != rxModel->End() && rx->fl <= tx->fc)
+        {
+            w[b] += power;
+        }
+    }
+    for (b = 0; b < w.size(); b++)
+    {
+        w[b] = total > 0 ? w[b] / total : 0.0;
+    }
+    return m_bandWeights.insert(std::make_pair(txPsd, w)).first->second;
+}
+
+double
+THzPhyMacro::CalcFrequencySelectiveSinr(const BandSignal& desired) const
+{
+    double noiseW = m_channel->GetNoiseW(0);
+    const std::vector<double>& w = *desired.weights;
+    double capacity = 0.0; // bit/s/Hz, weighted by the share of the signal in each band
+    double share = 0.0;
+    for (std::size_t b = 0; b < w.size(); b++)
+    {
+        if (w[b] <= 0)
+        {
+            continue;
+        }
+        // the band powers still hold the desired signal until RemoveBandSignal
+        double interference = std::max(m_bandPowerW[b] - desired.rxPowerW * w[b], 0.0);
+        double sinr = desired.rxPowerW * w[b] / (noiseW * m_bandNoiseShare[b] + interference);
+        capacity += w[b] * std::log2(1 + sinr);
+        share += w[b];
+    }
+    if (share <= 0)
+    {
+        return 0;
+    }
+    return std::pow(2.0, capacity / share) - 1;
+}
+
 void
 THzPhyMacro::ReceivePacketDone(Ptr<Packet> packet, double rxPower)
 {
     NS_LOG_FUNCTION("at node " << m_device->GetNode()->GetId() << "csBusy " << m_csBusyEnd
                                << " now " << Simulator::Now() << " state " << (m_state));
 
+    // in FrequencySelective mode the power of the packet leaves the bands only after every
+    // reception ending now is done, like the noise entries of the channel
+    BandSignal desired = {0, 0};
+    std::unordered_map<const Packet*, BandSignal>::iterator sig =
+        m_bandSignals.find(PeekPointer(packet));
+    if (sig != m_bandSignals.end())
+    {
+        desired = sig->second;
+        Simulator::ScheduleNow(&THzPhyMacro::RemoveBandSignal, this, packet);
+    }
+
     if (m_csBusyEnd <= Simulator::Now() + NanoSeconds(1))
     {
         m_csBusy = false;
@@ -362,6 +492,10 @@ THzPhyMacro::ReceivePacketDone(Ptr<Packet> packet, double rxPower)
         double noiseW = m_channel->GetNoiseW(interference); // noise plus interference
         double rxPowerW = m_channel->DbmToW(rxPower);
         double sinr = rxPowerW / noiseW;
+        if (desired.weights)
+        {
+            sinr = CalcFrequencySelectiveSinr(desired);
+        }
         double sinrDb = 10 * std::log10(sinr);
         NS_LOG_DEBUG("SINR = " << sinrDb << " dB; SINR TH = " << m_sinrTh << " dB");
         // ADD: CHANGE STATUS
@@ -371,7 +505,8 @@ THzPhyMacro::ReceivePacketDone(Ptr<Packet> packet, double rxPower)
         if (sinrDb > m_sinrTh)
         {
             m_state = IDLE;
-            m_mac->ReceivePacketDone(this, packet, true, rxPower);
+            // the channel shares the packet among all receivers, the MAC gets its own copy
+            m_mac->ReceivePacketDone(this, packet->Copy(), true, rxPower);
             return;
         }
         else
@@ -395,6 +530,29 @@ THzPhyMacro::ReceivePacketDone(Ptr<Packet> packet, double rxPower)
     }
 }
 
+void
+THzPhyMacro::RemoveBandSignal(Ptr<Packet> packet)
+{
+    std::unordered_map<const Packet*, BandSignal>::iterator sig =
+        m_bandSignals.find(PeekPointer(packet));
+    if (sig == m_bandSignals.end())
+    {
+        return;
+    }
+    BandSignal signal = sig->second;
+    m_bandSignals.erase(sig);
+    if (m_bandSignals.empty())
+    {
+        // drop the rounding error accumulated by the running sums
+        std::fill(m_bandPowerW.begin(), m_bandPowerW.end(), 0.0);
+        return;
+    }
+    for (std::size_t b = 0; b < signal.weights->size(); b++)
+    {
+        m_bandPowerW[b] -= signal.rxPowerW * (*signal.weights)[b];
+    }
+}
+
 bool
 THzPhyMacro::IsIdle()
 {
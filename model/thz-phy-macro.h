@@ -34,6 +34,9 @@
 #include "ns3/traced-value.h"
 
 #include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -112,6 +115,11 @@ class THzPhyMacro : public THzPhy
      */
     Ptr<THzChannel> GetChannel();
 
+    /**
+     * \return the spectrum model of m_txPsd, or 0 before CalTxPsd has run.
+     */
+    Ptr<const SpectrumModel> GetRxSpectrumModel() const;
+
     /**
      * \brief get MAC address
      *
@@ -165,6 +173,16 @@ class THzPhyMacro : public THzPhy
      */
     void ReceivePacket(Ptr<Packet> packet, Time txDuration, double_t rxPower);
 
+    /**
+     * \param packet packet received from lower layer (terahertz channel).
+     * \param rxPower power strength of the received packet, unit in dBm.
+     * \param txPsd the transmit power spectral density of the packet.
+     *
+     * In FrequencySelective mode, adds the power of the packet to the bands of this PHY it falls
+     * into, until ReceivePacketDone.
+     */
+    void NotifyRxSignal(Ptr<Packet> packet, double rxPower, Ptr<const SpectrumValue> txPsd);
+
     /**
      * \param packet packet received from lower layer (terahertz channel).
      * \param rxPower power strength of the received packet.
@@ -199,6 +217,41 @@ class THzPhyMacro : public THzPhy
     double DbmToW(double dbm);
 
   private:
+    /**
+     * A signal being received, as seen by the bands of this PHY.
+     */
+    typedef struct
+    {
+        const std::vector<double>* weights; //!< share of the signal power in each band
+        double rxPowerW;                    //!< received power of the signal (W)
+    } BandSignal;
+
+    /**
+     * \param txPsd a transmit power spectral density.
+     *
+     * \return the share of the power of txPsd falling into each band of this PHY, computed once
+     *         per PSD. Each transmit band is attributed to the receive band holding its center.
+     */
+    const std::vector<double>& GetBandWeights(Ptr<const SpectrumValue> txPsd);
+
+    /**
+     * \param desired the signal to decode.
+     *
+     * \return the effective SINR of the signal: the SINR whose capacity is the average over
+     *         bands, weighted by the share of the signal in each band, of the capacity at the
+     *         per-band SINR. The white noise is split over the bands by their bandwidth.
+     */
+    double CalcFrequencySelectiveSinr(const BandSignal& desired) const;
+
+    /**
+     * \param packet a packet whose reception is done.
+     *
+     * Removes the power of the packet from the bands. Scheduled with ScheduleNow by
+     * ReceivePacketDone, so a signal ending at the same instant as the desired one still
+     * interferes with it whatever the order of their events.
+     */
+    void RemoveBandSignal(Ptr<Packet> packet);
+
     typedef enum
     {
         IDLE,
@@ -212,7 +265,7 @@ class THzPhyMacro : public THzPhy
     Ptr<THzNetDevice> m_device;
     Ptr<THzMac> m_mac;
     Ptr<THzChannel> m_channel;
-    Ptr<SpectrumValue> m_txPsd;
+    Ptr<const SpectrumValue> m_txPsd;
 
     Ptr<Packet> m_pktRx;
     Time m_preambleDuration; //!< Duration (us) of Preamble of PHY Layer
@@ -240,6 +293,12 @@ class THzPhyMacro : public THzPhy
 
     std::list<OngoingRx> m_ongoingRx;
 
+    bool m_frequencySelective;                 //!< compute the SINR band by band
+    std::vector<double> m_bandPowerW;          //!< power of the ongoing signals in each band (W)
+    std::vector<double> m_bandNoiseShare;      //!< share of the noise bandwidth of each band
+    std::unordered_map<const Packet*, BandSignal> m_bandSignals; //!< ongoing signals
+    std::map<Ptr<const SpectrumValue>, std::vector<double>> m_bandWeights; //!< by transmit PSD
+
   protected:
 };
 
@@ -137,6 +137,16 @@ THzPhyNano::GetChannel()
     return m_channel;
 }
 
+Ptr<const SpectrumModel>
+THzPhyNano::GetRxSpectrumModel() const
+{
+    if (!m_txPsd)
+    {
+        return 0;
+    }
+    return m_txPsd->GetSpectrumModel();
+}
+
 Mac48Address
 THzPhyNano::GetAddress()
 {
@@ -156,16 +166,17 @@ THzPhyNano::CalTxPsd()
     NS_LOG_FUNCTION("");
     double txPowerW = DbmToW(m_txPower);
     Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
-    Ptr<SpectrumModel> InitTHzSpectrumWave;
-    Ptr<SpectrumModel> InitTHzSpectrumWaveAll;
-    Ptr<SpectrumModel> InitTHzPulseSpectrumWaveform;
-    InitTHzSpectrumWave = sf->THzSpectrumWaveformInitializer();
-    InitTHzSpectrumWaveAll = sf->AllTHzSpectrumWaveformInitializer();
-    InitTHzPulseSpectrumWaveform = sf->THzPulseSpectrumWaveformInitializer();
-    m_txPsd = sf->CreatePulsePowerSpectralDensity(1, m_pulseDuration.ToDouble(Time::S), txPowerW);
+    // shared by PHYs of the same configuration
+    m_txPsd = sf->GetPulsePowerSpectralDensity(1, m_pulseDuration.ToDouble(Time::S), txPowerW);
     m_numberOfSamples = sf->m_numsample;
     m_numberOfSubBands = sf->m_numsb;
     m_subBandBandwidth = sf->m_sbw;
+    if (m_channel)
+    {
+        // build the per-band loss coefficients of m_txPsd once, ahead of the first transmission
+        m_channel->GetPropagationLossModel()->GetBandCoefficients(m_txPsd->GetSpectrumModel());
+        m_channel->NotifyRxSpectrumModelChanged();
+    }
 }
 
 bool
@@ -443,7 +454,8 @@ THzPhyNano::ReceivePacketDone(Ptr<Packet> packet, double rxPower)
             if (it->m_collided == false)
             {
                 NS_LOG_INFO("Packet hasn't collided!");
-                m_mac->ReceivePacketDone(this, packet, true, rxPower);
+                // the channel shares the packet among all receivers, the MAC gets its own copy
+                m_mac->ReceivePacketDone(this, packet->Copy(), true, rxPower);
                 m_ongoingRx.erase(it);
                 return;
             }
@@ -126,6 +126,11 @@ class THzPhyNano : public THzPhy
      * \ return the value of m_channel flag.
      */
     Ptr<THzChannel> GetChannel();
+
+    /**
+     * \return the spectrum model of m_txPsd, or 0 before CalTxPsd has run.
+     */
+    Ptr<const SpectrumModel> GetRxSpectrumModel() const;
     /**
      * \ return the Mac48Address
      *
@@ -208,7 +213,7 @@ class THzPhyNano : public THzPhy
     Ptr<THzNetDevice> m_device;
     Ptr<THzMac> m_mac;
     Ptr<THzChannel> m_channel;
-    Ptr<SpectrumValue> m_txPsd;
+    Ptr<const SpectrumValue> m_txPsd;
 
     Time Ts;
     Time m_pulseDuration;
@@ -79,6 +79,14 @@ class THzPhy : public Object
      */
     virtual Ptr<THzChannel> GetChannel() = 0;
 
+    /**
+     * \return the spectrum model of the band this PHY operates on, or 0 before its PSD is set.
+     *
+     * Used by the terahertz channel to deliver a transmission only to the PHYs whose band
+     * overlaps the transmitted one.
+     */
+    virtual Ptr<const SpectrumModel> GetRxSpectrumModel() const = 0;
+
     /**
      * \brief get MAC address
      *
@@ -119,9 +127,23 @@ class THzPhy : public Object
      *
      * Called from terahertz channel to indicate the packet is been receiving by the receiver.
      * Terahertz physical layer need to pass this message to the upper layer (terahertz MAC layer)
+     *
+     * The packet is shared by every receiver of the transmission and must not be modified.
      */
     virtual void ReceivePacket(Ptr<Packet> packet, Time txDuration, double_t rxPower) = 0;
 
+    /**
+     * \param packet packet received from lower layer (terahertz channel).
+     * \param rxPower power strength of the received packet, unit in dBm.
+     * \param txPsd the transmit power spectral density of the packet.
+     *
+     * Called from terahertz channel right before ReceivePacket, for physical layers that account
+     * for the spectrum of each signal. Does nothing by default.
+     */
+    virtual void NotifyRxSignal(Ptr<Packet> packet, double rxPower, Ptr<const SpectrumValue> txPsd)
+    {
+    }
+
     /**
      * \param packet packet received from lower layer (terahertz channel).
      * \param rxPower power strength of the received packet.
@@ -129,6 +151,9 @@ class THzPhy : public Object
      * Called from terahertz channel to indicate the packet is been completely received by the
      * receiver. Terahertz physical layer need to pass this message to the upper layer (terahertz
      * MAC layer)
+     *
+     * The packet is shared by every receiver of the transmission, a successfully received packet
+     * is copied before the MAC layer processes it.
      */
     virtual void ReceivePacketDone(Ptr<Packet> packet, double rxPower) = 0;
 
@@ -23,21 +23,29 @@
 
 #include "thz-spectrum-propagation-loss.h"
 
+#include "thz-absorption-table.h"
+#include "thz-band-presets.h"
+
 #include <ns3/angles.h>
 #include <ns3/antenna-model.h>
+#include <ns3/boolean.h>
 #include <ns3/core-module.h>
 #include <ns3/cosine-antenna-model.h>
 #include <ns3/double.h>
 #include <ns3/log.h>
 #include <ns3/mobility-model.h>
 #include <ns3/object.h>
+#include <ns3/string.h>
 #include <ns3/thz-spectrum-waveform.h>
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
 #include <iostream>
-#include <map>
+#include <limits>
 #include <string>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
 #include <vector>
 
 NS_LOG_COMPONENT_DEFINE("THzSpectrumPropagationLoss");
@@ -45,16 +53,416 @@ NS_LOG_COMPONENT_DEFINE("THzSpectrumPropagationLoss");
 namespace ns3
 {
 
+namespace
+{
+const double REFERENCE_WATER_FRACTION = 0.1;  //!< water vapor molecules of the database atmosphere
+const double REFERENCE_TEMPERATURE = 296;     //!< temperature of the database atmosphere [K]
+const double REFERENCE_PRESSURE = 101325;     //!< pressure of the database atmosphere [Pa]
+
+const double TABLE_DISTANCE_MIN = 1e-5;     //!< first distance of the path gain tables [m]
+const uint32_t TABLE_DECADES = 8;           //!< decades of distance covered by the tables
+const uint32_t TABLE_POINTS_MIN = 16;       //!< initial number of intervals per decade
+const uint32_t TABLE_POINTS_MAX = 1 << 16;  //!< largest number of intervals per decade
+
+/**
+ * \param temperature the air temperature, unit in Kelvin.
+ * \return the saturation vapor pressure of water over liquid water (Buck, 1981), unit in Pascal.
+ */
+double
+GetSaturationVaporPressure(double temperature)
+{
+    double t = temperature - 273.15;
+    return 611.21 * std::exp((18.678 - t / 234.5) * (t / (257.14 + t)));
+}
+
+/**
+ * Water vapor line of ITU-R P.676-12, Annex 1, Table 2: the line frequency and the coefficients
+ * of its strength and width. The last line stands for the continuum of the far wings.
+ */
+struct WaterVaporLine
+{
+    double f0; //!< line frequency [GHz]
+    double b1; //!< line strength at 300 K [kHz/hPa]
+    double b2; //!< temperature exponent of the strength
+    double b3; //!< width per hPa of dry air at 300 K [1e-4 GHz/hPa]
+    double b4; //!< temperature exponent of the dry air broadened width
+    double b5; //!< ratio of the self to the dry air broadened width
+    double b6; //!< temperature exponent of the self broadened width
+};
+
+const WaterVaporLine WATER_VAPOR_LINES[] = {
+    {22.235080, 0.1079, 2.144, 26.38, 0.76, 5.087, 1.00},
+    {67.803960, 0.0011, 8.732, 28.58, 0.69, 4.930, 0.82},
+    {119.995940, 0.0007, 8.353, 29.48, 0.70, 4.780, 0.79},
+    {183.310087, 2.273, 0.668, 29.06, 0.77, 5.022, 0.85},
+    {321.225630, 0.0470, 6.179, 24.04, 0.67, 4.398, 0.54},
+    {325.152888, 1.514, 1.541, 28.23, 0.64, 4.893, 0.74},
+    {336.227764, 0.0010, 9.825, 26.93, 0.69, 4.740, 0.61},
+    {380.197353, 11.67, 1.048, 28.11, 0.54, 5.063, 0.89},
+    {390.134508, 0.0045, 7.347, 21.52, 0.63, 4.810, 0.55},
+    {437.346667, 0.0632, 5.048, 18.45, 0.60, 4.230, 0.48},
+    {439.150807, 0.9098, 3.595, 20.07, 0.63, 4.483, 0.52},
+    {443.018343, 0.1920, 5.048, 15.55, 0.60, 5.083, 0.50},
+    {448.001085, 10.41, 1.405, 25.64, 0.66, 5.028, 0.67},
+    {470.888999, 0.3254, 3.597, 21.34, 0.66, 4.506, 0.65},
+    {474.689092, 1.260, 2.379, 23.20, 0.65, 4.804, 0.64},
+    {488.490108, 0.2529, 2.852, 25.86, 0.69, 5.201, 0.72},
+    {503.568532, 0.0372, 6.731, 16.12, 0.61, 3.980, 0.43},
+    {504.482692, 0.0124, 6.731, 16.12, 0.61, 4.010, 0.45},
+    {547.676440, 0.9785, 0.158, 26.00, 0.70, 4.500, 1.00},
+    {552.020960, 0.1840, 0.158, 26.00, 0.70, 4.500, 1.00},
+    {556.935985, 497.0, 0.159, 30.86, 0.69, 4.552, 1.00},
+    {620.700807, 5.015, 2.391, 24.38, 0.71, 4.856, 0.68},
+    {645.766085, 0.0067, 8.633, 18.00, 0.60, 4.000, 0.50},
+    {658.005280, 0.2732, 7.816, 32.10, 0.69, 4.140, 1.00},
+    {752.033113, 243.4, 0.396, 30.86, 0.68, 4.352, 0.84},
+    {841.051732, 0.0134, 8.177, 15.90, 0.33, 5.760, 0.45},
+    {859.965698, 0.1325, 8.055, 30.60, 0.68, 4.090, 0.84},
+    {899.303175, 0.0547, 7.914, 29.85, 0.68, 4.530, 0.90},
+    {902.611085, 0.0386, 8.429, 28.65, 0.70, 5.100, 0.95},
+    {906.205957, 0.1836, 5.110, 24.08, 0.70, 4.700, 0.53},
+    {916.171582, 8.400, 1.441, 26.73, 0.70, 5.150, 0.78},
+    {923.112692, 0.0079, 10.293, 29.00, 0.70, 5.000, 0.80},
+    {970.315022, 9.009, 1.919, 25.50, 0.64, 4.940, 0.67},
+    {987.926764, 134.6, 0.257, 29.85, 0.68, 4.550, 0.90},
+    {1780.000000, 17506., 0.952, 196.3, 2.00, 24.15, 5.00},
+};
+
+/**
+ * \param f the frequency, unit in Hz.
+ * \param dryPressure the partial pressure of dry air, unit in Pascal.
+ * \param vaporPressure the partial pressure of water vapor, unit in Pascal.
+ * \param temperature the air temperature, unit in Kelvin.
+ *
+ * \return the sum over the water vapor lines of ITU-R P.676-12 of the line strength times the
+ *         line shape at f, which the specific attenuation of water vapor is proportional to.
+ */
+double
+CalcWaterVaporLineSum(double f, double dryPressure, double vaporPressure, double temperature)
+{
+    double fGHz = f / 1e9;
+    double p = dryPressure / 100; // [hPa]
+    double e = vaporPressure / 100;
+    double theta = 300 / temperature;
+    double sum = 0;
+    for (const WaterVaporLine& l : WATER_VAPOR_LINES)
+    {
+        double strength = l.b1 * 0.1 * e * std::pow(theta, 3.5) * std::exp(l.b2 * (1 - theta));
+        double width = l.b3 * 1e-4 * (p * std::pow(theta, l.b4) + l.b5 * e * std::pow(theta, l.b6));
+        // Doppler broadening
+        width = 0.535 * width +
+                std::sqrt(0.217 * width * width + 2.1316e-12 * l.f0 * l.f0 / theta);
+        double below = l.f0 - fGHz;
+        double above = l.f0 + fGHz;
+        double shape = fGHz / l.f0 *
+                       (width / (below * below + width * width) +
+                        width / (above * above + width * width));
+        sum += strength * shape;
+    }
+    return sum;
+}
+
+/**
+ * \param model a spectrum model.
+ *
+ * \return true if the bands of model have the edges of one of the band presets, as built by
+ *         THzSpectrumValueFactory for the transmit PSD of that preset.
+ */
+bool
+IsPresetModel(Ptr<const SpectrumModel> model)
+{
+    if (model->GetNumBands() != THZ_PRESET_NUM_SAMPLE)
+    {
+        return false;
+    }
+    const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>* presets[] = {
+        &THZ_PRESET_1_0345_THZ_EDGES,
+        &THZ_PRESET_802_15_3D_EDGES};
+    for (const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>* edges : presets)
+    {
+        // the edges are offsets from the lower edge of the first band, which the factory shifts
+        // to the start frequency of the window
+        double origin = model->Begin()->fl - (*edges)[0];
+        double tolerance = 1e-9 * (*edges)[THZ_PRESET_NUM_SAMPLE];
+        bool match = true;
+        uint32_t j = 0;
+        for (Bands::const_iterator it = model->Begin(); match && it != model->End(); ++it, ++j)
+        {
+            match = std::abs(it->fl - origin - (*edges)[j]) <= tolerance &&
+                    std::abs(it->fh - origin - (*edges)[j + 1]) <= tolerance;
+        }
+        if (match)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// dynamic type of the loss model, database file, humidity, temperature and pressure of an
+/// environment
+typedef std::tuple<std::type_index, std::string, double, double, double> EnvironmentKey;
+
+/**
+ * \return the band coefficients built so far for each environment.
+ */
+std::map<EnvironmentKey, std::map<SpectrumModelUid_t, Ptr<const THzBandCoefficients>>>&
+GetEnvironmentRegistry()
+{
+    static std::map<EnvironmentKey, std::map<SpectrumModelUid_t, Ptr<const THzBandCoefficients>>>
+        registry;
+    return registry;
+}
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(THzSpectrumPropagationLoss);
 
+TypeId
+THzSpectrumPropagationLoss::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::THzSpectrumPropagationLoss")
+            .SetParent<Object>()
+            .AddConstructor<THzSpectrumPropagationLoss>()
+            .AddAttribute("AbsorptionDatabase",
+                          "Binary absorption table read block by block, with the coefficient "
+                          "interpolated at the center of each band. Empty for the default "
+                          "database of the module.",
+                          StringValue(""),
+                          MakeStringAccessor(&THzSpectrumPropagationLoss::SetAbsorptionDatabase,
+                                             &THzSpectrumPropagationLoss::GetAbsorptionDatabase),
+                          MakeStringChecker())
+            .AddAttribute("Humidity",
+                          "Relative humidity (%) the absorption coefficients are scaled to. "
+                          "Negative to use the coefficients of the database unchanged.",
+                          DoubleValue(-1),
+                          MakeDoubleAccessor(&THzSpectrumPropagationLoss::SetHumidity,
+                                             &THzSpectrumPropagationLoss::GetHumidity),
+                          MakeDoubleChecker<double>(-1, 100))
+            .AddAttribute("Temperature",
+                          "Air temperature (K) the absorption coefficients are scaled to. "
+                          "Only used when Humidity is not negative.",
+                          DoubleValue(REFERENCE_TEMPERATURE),
+                          MakeDoubleAccessor(&THzSpectrumPropagationLoss::SetTemperature,
+                                             &THzSpectrumPropagationLoss::GetTemperature),
+                          MakeDoubleChecker<double>(200, 350))
+            .AddAttribute("Pressure",
+                          "Air pressure (Pa) the absorption coefficients are scaled to. "
+                          "Only used when Humidity is not negative.",
+                          DoubleValue(REFERENCE_PRESSURE),
+                          MakeDoubleAccessor(&THzSpectrumPropagationLoss::SetPressure,
+                                             &THzSpectrumPropagationLoss::GetPressure),
+                          MakeDoubleChecker<double>(1000, 200000))
+            .AddAttribute("PathGainTable",
+                          "If true, the path gain is interpolated in a table built once per "
+                          "transmit PSD over a logarithmic distance grid, instead of being "
+                          "summed over all bands for every receiver.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzSpectrumPropagationLoss::m_pathGainTableEnabled),
+                          MakeBooleanChecker())
+            .AddAttribute("PathGainTableMaxError",
+                          "Largest interpolation error (dB) of the path gain tables",
+                          DoubleValue(0.01),
+                          MakeDoubleAccessor(&THzSpectrumPropagationLoss::SetPathGainTableMaxError,
+                                             &THzSpectrumPropagationLoss::GetPathGainTableMaxError),
+                          MakeDoubleChecker<double>(1e-6));
+    return tid;
+}
+
 THzSpectrumPropagationLoss::THzSpectrumPropagationLoss()
+    : m_database(0),
+      m_pathGainTableEnabled(false),
+      m_pathGainTableMaxError(0.01),
+      m_humidity(-1),
+      m_temperature(REFERENCE_TEMPERATURE),
+      m_pressure(REFERENCE_PRESSURE),
+      m_vaporPressure(0),
+      m_bandCoefficients(0),
+      m_lastUid(0),
+      m_lastCoefficients(0)
 {
+    UpdateEnvironment();
 }
 
 THzSpectrumPropagationLoss::~THzSpectrumPropagationLoss()
 {
 }
 
+void
+THzSpectrumPropagationLoss::SetAbsorptionDatabase(std::string fileName)
+{
+    NS_LOG_FUNCTION(this << fileName);
+    m_databaseFile = fileName;
+    m_database = fileName.empty() ? 0 : THzPagedAbsorptionTable::Get(fileName);
+    UpdateEnvironment();
+}
+
+std::string
+THzSpectrumPropagationLoss::GetAbsorptionDatabase() const
+{
+    return m_databaseFile;
+}
+
+void
+THzSpectrumPropagationLoss::SetEnvironment(double humidity, double temperature, double pressure)
+{
+    NS_LOG_FUNCTION(this << humidity << temperature << pressure);
+    NS_ASSERT(temperature > 0);
+    NS_ASSERT(pressure > 0);
+    m_humidity = humidity;
+    m_temperature = temperature;
+    m_pressure = pressure;
+    UpdateEnvironment();
+}
+
+void
+THzSpectrumPropagationLoss::SetHumidity(double humidity)
+{
+    SetEnvironment(humidity, m_temperature, m_pressure);
+}
+
+double
+THzSpectrumPropagationLoss::GetHumidity() const
+{
+    return m_humidity;
+}
+
+void
+THzSpectrumPropagationLoss::SetTemperature(double temperature)
+{
+    SetEnvironment(m_humidity, temperature, m_pressure);
+}
+
+double
+THzSpectrumPropagationLoss::GetTemperature() const
+{
+    return m_temperature;
+}
+
+void
+THzSpectrumPropagationLoss::SetPressure(double pressure)
+{
+    SetEnvironment(m_humidity, m_temperature, pressure);
+}
+
+double
+THzSpectrumPropagationLoss::GetPressure() const
+{
+    return m_pressure;
+}
+
+double
+THzSpectrumPropagationLoss::GetAbsorptionScale(double f) const
+{
+    if (m_humidity < 0)
+    {
+        return 1;
+    }
+    double reference = CalcWaterVaporLineSum(f,
+                                             (1 - REFERENCE_WATER_FRACTION) * REFERENCE_PRESSURE,
+                                             REFERENCE_WATER_FRACTION * REFERENCE_PRESSURE,
+                                             REFERENCE_TEMPERATURE);
+    // the water vapor cannot exceed the air pressure, whatever the order the attributes are set in
+    double dryPressure = std::max(m_pressure - m_vaporPressure, 0.0);
+    return CalcWaterVaporLineSum(f, dryPressure, m_vaporPressure, m_temperature) / reference;
+}
+
+void
+THzSpectrumPropagationLoss::UpdateEnvironment()
+{
+    m_vaporPressure =
+        m_humidity < 0 ? 0 : m_humidity / 100 * GetSaturationVaporPressure(m_temperature);
+    NS_LOG_INFO("Environment of humidity " << m_humidity << "%, temperature " << m_temperature
+                                           << " K, pressure " << m_pressure << " Pa");
+    // selected on the next lookup, when the dynamic type is known even if called from the
+    // constructor
+    m_bandCoefficients = 0;
+    m_lastUid = 0;
+    m_lastCoefficients = 0;
+}
+
+Ptr<const THzBandCoefficients>
+THzSpectrumPropagationLoss::GetBandCoefficients(Ptr<const SpectrumModel> model)
+{
+    SpectrumModelUid_t uid = model->GetUid();
+    if (m_lastCoefficients && uid == m_lastUid)
+    {
+        return m_lastCoefficients;
+    }
+    if (!m_bandCoefficients)
+    {
+        // a subclass may compute other coefficients, so it never shares those of another type
+        std::type_index type(typeid(*this));
+        EnvironmentKey key = m_humidity < 0
+                                 ? EnvironmentKey(type, m_databaseFile, -1, 0, 0)
+                                 : EnvironmentKey(type,
+                                                  m_databaseFile,
+                                                  m_humidity,
+                                                  m_temperature,
+                                                  m_pressure);
+        m_bandCoefficients = &GetEnvironmentRegistry()[key];
+    }
+    BandCoefficientMap::const_iterator it = m_bandCoefficients->find(uid);
+    if (it == m_bandCoefficients->end())
+    {
+        Ptr<THzBandCoefficients> coe = Create<THzBandCoefficients>();
+        coe->kf.reserve(model->GetNumBands());
+        coe->invSpread.reserve(model->GetNumBands());
+        coe->preset = IsPresetModel(model);
+        for (Bands::const_iterator fit = model->Begin(); fit != model->End(); ++fit)
+        {
+            double spread_sqrt = 299792458 / (4 * M_PI * fit->fc);
+            coe->kf.push_back(GetAbsorptionCoefficient(fit->fc));
+            coe->invSpread.push_back(spread_sqrt * spread_sqrt);
+        }
+        NS_LOG_INFO("Built band coefficients of spectrum model " << uid << " with "
+                                                                << model->GetNumBands()
+                                                                << " bands");
+        it = m_bandCoefficients->insert(std::make_pair(uid, coe)).first;
+    }
+    m_lastUid = uid;
+    m_lastCoefficients = it->second;
+    return m_lastCoefficients;
+}
+
+bool
+THzSpectrumPropagationLoss::UseBandCoefficients() const
+{
+    return typeid(*this) == typeid(THzSpectrumPropagationLoss);
+}
+
+double
+THzSpectrumPropagationLoss::IntegrateRxPsdPerBand(const SpectrumValue& txPsd, double d)
+{
+    double sum = 0.0;
+    Bands::const_iterator fit = txPsd.ConstBandsBegin();
+    for (Values::const_iterator vit = txPsd.ConstValuesBegin(); vit != txPsd.ConstValuesEnd();
+         ++vit, ++fit)
+    {
+        sum += *vit / (CalculateSpreadLoss(fit->fc, d) * CalculateAbsLoss(fit->fc, d));
+    }
+    return sum;
+}
+
+double
+THzSpectrumPropagationLoss::IntegrateRxPsd(const SpectrumValue& txPsd,
+                                           const THzBandCoefficients& coe,
+                                           double d) const
+{
+    const uint32_t n = coe.kf.size();
+    NS_ASSERT(txPsd.GetValuesN() == n);
+    const double* psd = &txPsd.ValuesAt(0);
+    const double* kf = coe.kf.data();
+    const double* invSpread = coe.invSpread.data();
+
+    double sum = 0.0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        sum += psd[i] * invSpread[i] * std::exp(-kf[i] * d);
+    }
+    return sum / (d * d);
+}
+
 Ptr<SpectrumValue>
 THzSpectrumPropagationLoss::CalcRxPowerSpectralDensity(Ptr<const SpectrumValue> txPsd,
                                                        Ptr<const MobilityModel> a,
@@ -62,20 +470,24 @@ THzSpectrumPropagationLoss::CalcRxPowerSpectralDensity(Ptr<const SpectrumValue>
 {
     Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue>(txPsd); //[W]
     Values::iterator vit = rxPsd->ValuesBegin();
-    Bands::const_iterator fit = rxPsd->ConstBandsBegin();
 
     NS_ASSERT(a);
     NS_ASSERT(b);
     double d = a->GetDistanceFrom(b);
-    while (vit != rxPsd->ValuesEnd())
+    if (!UseBandCoefficients())
     {
-        NS_ASSERT(fit != rxPsd->ConstBandsEnd());
-        double lossDb = 10 * std::log10(CalculateSpreadLoss(fit->fc, d)) +
-                        10 * std::log10(CalculateAbsLoss(fit->fc, d));
-        double lossW = std::pow(10.0, lossDb / 10.0);
-        *vit /= lossW;
-        ++vit;
-        ++fit;
+        Bands::const_iterator fit = rxPsd->ConstBandsBegin();
+        for (; vit != rxPsd->ValuesEnd(); ++vit, ++fit)
+        {
+            *vit /= CalculateSpreadLoss(fit->fc, d) * CalculateAbsLoss(fit->fc, d);
+        }
+        return rxPsd; //[W]
+    }
+    Ptr<const THzBandCoefficients> coe = GetBandCoefficients(txPsd->GetSpectrumModel());
+    double invD2 = 1.0 / (d * d);
+    for (uint32_t i = 0; vit != rxPsd->ValuesEnd(); ++vit, ++i)
+    {
+        *vit *= coe->invSpread[i] * std::exp(-coe->kf[i] * d) * invD2;
     }
     return rxPsd; //[W]
 }
@@ -87,25 +499,28 @@ THzSpectrumPropagationLoss::CalcRxPowerDA(Ptr<THzSpectrumSignalParameters> txPar
                                           double RxTxGainDb)
 {
     double RxTxGainW = std::pow(10.0, (RxTxGainDb) / 10.0);
-    Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue>(txParams->txPsd); // [W]
-    Values::iterator vit = rxPsd->ValuesBegin();
-    Bands::const_iterator fit = rxPsd->ConstBandsBegin();
 
     NS_ASSERT(a);
     NS_ASSERT(b);
     double d = a->GetDistanceFrom(b);
     NS_LOG_INFO("Distance = " << d);
-    double rxPsd_inte = 0.0;
-    while (vit != rxPsd->ValuesEnd())
-    {
-        NS_ASSERT(fit != rxPsd->ConstBandsEnd());
-        double lossDb = 10 * std::log10(CalculateSpreadLoss(fit->fc, d)) +
-                        10 * std::log10(CalculateAbsLoss(fit->fc, d));
-        double lossW = std::pow(10.0, lossDb / 10.0);
-        *vit /= lossW;
-        rxPsd_inte += *vit;
-        ++vit;
-        ++fit;
+    double rxPsd_inte;
+    if (!UseBandCoefficients())
+    {
+        rxPsd_inte = IntegrateRxPsdPerBand(*txParams->txPsd, d);
+    }
+    else if (m_pathGainTableEnabled)
+    {
+        Ptr<const THzBandCoefficients> coe =
+            GetBandCoefficients(txParams->txPsd->GetSpectrumModel());
+        LookupSums(txParams->txPsd, *coe, &d, &rxPsd_inte, 1);
+        rxPsd_inte /= d * d;
+    }
+    else
+    {
+        Ptr<const THzBandCoefficients> coe =
+            GetBandCoefficients(txParams->txPsd->GetSpectrumModel());
+        rxPsd_inte = IntegrateRxPsd(*txParams->txPsd, *coe, d);
     }
     NS_LOG_INFO("rxPsd_inte = " << rxPsd_inte << " RxTxGainW " << RxTxGainW);
     double rxPower = rxPsd_inte * txParams->subBandBandwidth *
@@ -116,90 +531,324 @@ THzSpectrumPropagationLoss::CalcRxPowerDA(Ptr<THzSpectrumSignalParameters> txPar
     return rxPowerDbm;
 }
 
-double
-THzSpectrumPropagationLoss::CalculateSpreadLoss(double f, double d) const
+void
+THzSpectrumPropagationLoss::CalcRxPowerDABatch(Ptr<THzSpectrumSignalParameters> txParams,
+                                               const std::vector<double>& distance,
+                                               const std::vector<double>& RxTxGainDb,
+                                               std::vector<double>& rxPowerDbm)
 {
-    NS_ASSERT(d >= 0);
-
-    if (d == 0)
+    NS_ASSERT(distance.size() == RxTxGainDb.size());
+    CalcPathGainBatch(txParams, distance, rxPowerDbm);
+    for (std::size_t r = 0; r < rxPowerDbm.size(); r++)
     {
-        return 0;
+        rxPowerDbm[r] = CalcRxPowerDbm(rxPowerDbm[r], RxTxGainDb[r]);
     }
-
-    NS_ASSERT(f > 0);
-    double loss_sqrt = (4 * M_PI * f * d) / 299792458;
-    double loss = loss_sqrt * loss_sqrt;
-    return loss;
 }
 
-double
-THzSpectrumPropagationLoss::CalculateAbsLoss(double f, double d)
+void
+THzSpectrumPropagationLoss::CalcPathGainBatch(Ptr<THzSpectrumSignalParameters> txParams,
+                                              const std::vector<double>& distance,
+                                              std::vector<double>& pathGain,
+                                              Ptr<THzWorkerPool> pool)
 {
-    double kf = 0.0;
-    double loss = 0.0;
-
-    if (mapContainsKey(m_freqMap, f))
+    const double sbw = txParams->subBandBandwidth;
+    const double ratio = txParams->numberOfSubBands / txParams->numberOfSamples;
+    if (!UseBandCoefficients())
     {
-        kf = m_freqMap[f];
+        // the overridden losses may not be thread-safe, so they run on the simulation thread
+        pathGain.resize(distance.size());
+        for (std::size_t r = 0; r < distance.size(); r++)
+        {
+            pathGain[r] = IntegrateRxPsdPerBand(*txParams->txPsd, distance[r]) * sbw * ratio;
+        }
+        return;
     }
-    else
+    Ptr<const THzBandCoefficients> coe = GetBandCoefficients(txParams->txPsd->GetSpectrumModel());
+    const uint32_t nBands = coe->kf.size();
+    const std::size_t nRx = distance.size();
+    NS_ASSERT(txParams->txPsd->GetValuesN() == nBands);
+
+    pathGain.assign(nRx, 0.0);
+    const double* psd = &txParams->txPsd->ValuesAt(0);
+    if (m_pathGainTableEnabled)
     {
-        std::ifstream AbsCoefile;
-        AbsCoefile.open("contrib/thz/model/data_AbsCoe.txt", std::ifstream::in);
-        if (!AbsCoefile.is_open())
+        LookupSums(txParams->txPsd, *coe, distance.data(), pathGain.data(), nRx);
+        for (std::size_t r = 0; r < nRx; r++)
         {
-            NS_FATAL_ERROR("THzSpectrumPropagationLoss::CalculateAbsLoss: open data_AbsCoe.txt failed 1");
+            double rxPsd_inte = pathGain[r] / (distance[r] * distance[r]);
+            pathGain[r] = rxPsd_inte * sbw * ratio;
         }
+        NS_LOG_INFO("Looked up the path gain of " << nRx << " receivers");
+        return;
+    }
+    // below about 64k exponentials per frame waking the workers costs more than it saves
+    if (pool && pool->GetNThreads() > 1 && nRx >= pool->GetNThreads() &&
+        nRx * nBands >= 65536)
+    {
+        const THzBandCoefficients& c = *coe;
+        const uint32_t nParts = pool->GetNThreads();
+        pool->Run([&](uint32_t part) {
+            std::size_t first = nRx * part / nParts;
+            std::size_t last = nRx * (part + 1) / nParts;
+            CalcPathGainRange(psd, c, &distance[first], &pathGain[first], last - first, sbw, ratio);
+        });
+    }
+    else
+    {
+        CalcPathGainRange(psd, *coe, distance.data(), pathGain.data(), nRx, sbw, ratio);
+    }
+    NS_LOG_INFO("Computed the path gain of " << nRx << " receivers over " << nBands << " bands");
+}
+
+void
+THzSpectrumPropagationLoss::CalcPathGainRange(const double* psd,
+                                              const THzBandCoefficients& coe,
+                                              const double* d,
+                                              double* acc,
+                                              std::size_t nRx,
+                                              double sbw,
+                                              double ratio) const
+{
+    const uint32_t nBands = coe.kf.size();
+    if (coe.preset)
+    {
+        CalcFixedBandPathGain<THZ_PRESET_NUM_SAMPLE>(psd,
+                                                     coe.invSpread.data(),
+                                                     coe.kf.data(),
+                                                     d,
+                                                     acc,
+                                                     nRx,
+                                                     sbw,
+                                                     ratio);
+        return;
+    }
 
-        std::ifstream frequencyfile;
-        frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-        if (!frequencyfile.is_open())
+    // acc first accumulates the integrated PSD of each receiver; bands are walked in the outer
+    // loop so the inner loop runs over contiguous receiver arrays
+    for (uint32_t i = 0; i < nBands; i++)
+    {
+        const double w = psd[i] * coe.invSpread[i];
+        const double kf = coe.kf[i];
+        for (std::size_t r = 0; r < nRx; r++)
         {
-            NS_FATAL_ERROR("THzSpectrumPropagationLoss::CalculateAbsLoss: open data_frequency.txt failed");
+            acc[r] += w * std::exp(-kf * d[r]);
         }
-        double f_ite;
-        double k_ite;
-        int i = 0;
-        int j = 0;
+    }
+
+    for (std::size_t r = 0; r < nRx; r++)
+    {
+        double rxPsd_inte = acc[r] / (d[r] * d[r]);
+        acc[r] = rxPsd_inte * sbw * ratio;
+    }
+}
+
+double
+THzSpectrumPropagationLoss::CalcLogSum(const double* psd,
+                                       const THzBandCoefficients& coe,
+                                       double d) const
+{
+    double sum = 0.0;
+    for (uint32_t i = 0; i < coe.kf.size(); i++)
+    {
+        sum += psd[i] * coe.invSpread[i] * std::exp(-coe.kf[i] * d);
+    }
+    return std::log(sum);
+}
+
+Ptr<const THzPathGainTable>
+THzSpectrumPropagationLoss::GetPathGainTable(Ptr<const SpectrumValue> txPsd)
+{
+    Ptr<const THzBandCoefficients> coe = GetBandCoefficients(txPsd->GetSpectrumModel());
+    PathGainTableMap::const_iterator it = m_pathGainTables.find(std::make_pair(txPsd, coe));
+    if (it != m_pathGainTables.end())
+    {
+        return it->second;
+    }
 
-        while (frequencyfile >> f_ite)
+    NS_ASSERT(txPsd->GetValuesN() == coe->kf.size());
+    const double* psd = &txPsd->ValuesAt(0);
+    // linear interpolation of ln(sum) is checked at the middle and quarters of every interval;
+    // the 1/d^2 factor is applied exactly, so this is also the error of the path gain in dB
+    const double maxError = m_pathGainTableMaxError * std::log(10.0) / 10;
+    Ptr<THzPathGainTable> table = Create<THzPathGainTable>();
+    table->logDistanceMin = std::log(TABLE_DISTANCE_MIN);
+    std::vector<double> values;
+    for (uint32_t k = 0; k < TABLE_DECADES; k++)
+    {
+        double logStart = table->logDistanceMin + k * std::log(10.0);
+        uint32_t n = TABLE_POINTS_MIN;
+        while (true)
         {
-            if (f_ite < f - 9.894e8 || f_ite > f + 9.894e8)
+            double step = std::log(10.0) / n;
+            values.resize(n + 1);
+            for (uint32_t j = 0; j <= n; j++)
             {
-                j++;
+                values[j] = CalcLogSum(psd, *coe, std::exp(logStart + j * step));
             }
-            else
+            if (!std::isfinite(values[n]))
             {
                 break;
             }
-        }
-        while (AbsCoefile >> k_ite)
-        {
-            if (i != j)
+            double error = 0;
+            for (uint32_t j = 0; j < n && error <= maxError; j++)
             {
-                i++;
+                for (double t : {0.25, 0.5, 0.75})
+                {
+                    double exact = CalcLogSum(psd, *coe, std::exp(logStart + (j + t) * step));
+                    double interpolated = values[j] + (values[j + 1] - values[j]) * t;
+                    error = std::max(error, std::abs(exact - interpolated));
+                }
             }
-            else
+            if (error <= maxError || n >= TABLE_POINTS_MAX)
             {
-                kf = k_ite;
+                if (error > maxError)
+                {
+                    NS_LOG_WARN("Path gain table error of " << error * 10 / std::log(10.0)
+                                                            << " dB in decade " << k);
+                }
                 break;
             }
-            NS_ASSERT(d >= 0);
+            n *= 2;
+        }
+        if (!std::isfinite(values[n]))
+        {
+            // the received power underflows, the remaining distances are computed exactly
+            break;
+        }
+        table->decadeOffset.push_back(table->logSum.size());
+        table->decadePoints.push_back(n);
+        table->logSum.insert(table->logSum.end(), values.begin(), values.end());
+    }
+    NS_LOG_INFO("Built a path gain table of " << table->logSum.size() << " points over "
+                                              << table->decadePoints.size() << " decades");
+    m_pathGainTables.insert(std::make_pair(std::make_pair(txPsd, coe), table));
+    return table;
+}
 
-            if (d == 0)
+void
+THzSpectrumPropagationLoss::LookupSums(Ptr<const SpectrumValue> txPsd,
+                                       const THzBandCoefficients& coe,
+                                       const double* d,
+                                       double* sum,
+                                       std::size_t nRx)
+{
+    Ptr<const THzPathGainTable> table = GetPathGainTable(txPsd);
+    const double* psd = &txPsd->ValuesAt(0);
+    for (std::size_t r = 0; r < nRx; r++)
+    {
+        if (!table->Interpolate(d[r], sum[r]))
+        {
+            sum[r] = 0.0;
+            for (uint32_t i = 0; i < coe.kf.size(); i++)
             {
-                return 0;
+                sum[r] += psd[i] * coe.invSpread[i] * std::exp(-coe.kf[i] * d[r]);
             }
         }
-        NS_ASSERT(f > 0);
-        m_freqMap.insert(std::pair<double, double>(f, kf));
-        NS_LOG_UNCOND("inserted to map f: " << f << " kf: " << kf);
-    } // if f != m_previousFc
+    }
+}
+
+void
+THzSpectrumPropagationLoss::SetPathGainTableMaxError(double maxError)
+{
+    m_pathGainTableMaxError = maxError;
+    m_pathGainTables.clear();
+}
+
+double
+THzSpectrumPropagationLoss::GetPathGainTableMaxError() const
+{
+    return m_pathGainTableMaxError;
+}
 
-    loss = exp(kf * d);
+bool
+THzPathGainTable::Interpolate(double d, double& sum) const
+{
+    if (!(d > 0))
+    {
+        return false;
+    }
+    double x = (std::log(d) - logDistanceMin) / std::log(10.0);
+    if (x < 0 || x >= decadePoints.size())
+    {
+        return false;
+    }
+    uint32_t k = static_cast<uint32_t>(x);
+    double u = (x - k) * decadePoints[k];
+    uint32_t j = std::min(static_cast<uint32_t>(u), decadePoints[k] - 1);
+    double t = u - j;
+    const double* v = &logSum[decadeOffset[k] + j];
+    sum = std::exp(v[0] + (v[1] - v[0]) * t);
+    return true;
+}
+
+double
+THzSpectrumPropagationLoss::CalcRxPowerDbm(double pathGain, double RxTxGainDb) const
+{
+    double RxTxGainW = std::pow(10.0, (RxTxGainDb) / 10.0);
+    double rxPower = pathGain * RxTxGainW;
+    return 10 * std::log10(rxPower * 1000.0);
+}
+
+double
+THzSpectrumPropagationLoss::CalcMaxRange(Ptr<THzSpectrumSignalParameters> txParams,
+                                         double maxGainDb,
+                                         double thresholdDbm)
+{
+    if (!UseBandCoefficients())
+    {
+        return std::numeric_limits<double>::infinity(); // no bound on the overridden losses
+    }
+    Ptr<const THzBandCoefficients> coe = GetBandCoefficients(txParams->txPsd->GetSpectrumModel());
+    const double* psd = &txParams->txPsd->ValuesAt(0);
+    double rxPsd_inte = 0.0; // integrated PSD at 1 m without absorption
+    for (uint32_t i = 0; i < coe->invSpread.size(); i++)
+    {
+        rxPsd_inte += psd[i] * coe->invSpread[i];
+    }
+    double rxPowerW = rxPsd_inte * txParams->subBandBandwidth *
+                      (txParams->numberOfSubBands / txParams->numberOfSamples) *
+                      std::pow(10.0, maxGainDb / 10.0);
+    double thresholdW = std::pow(10.0, thresholdDbm / 10.0) / 1000.0;
+    return std::sqrt(rxPowerW / thresholdW);
+}
+
+double
+THzSpectrumPropagationLoss::CalculateSpreadLoss(double f, double d) const
+{
+    NS_ASSERT(d >= 0);
+
+    if (d == 0)
+    {
+        return 0;
+    }
+
+    NS_ASSERT(f > 0);
+    double loss_sqrt = (4 * M_PI * f * d) / 299792458;
+    double loss = loss_sqrt * loss_sqrt;
+    return loss;
+}
+
+double
+THzSpectrumPropagationLoss::CalculateAbsLoss(double f, double d)
+{
+    NS_ASSERT(f > 0);
+    NS_ASSERT(d >= 0);
+    double kf = GetAbsorptionCoefficient(f);
+    double loss = exp(kf * d);
     return loss;
 }
 
+double
+THzSpectrumPropagationLoss::GetAbsorptionCoefficient(double f) const
+{
+    if (m_database)
+    {
+        return m_database->InterpolateCoefficient(f) * GetAbsorptionScale(f);
+    }
+    // the first grid point within +/- 9.894e8 Hz of f, as in the original file scan
+    return THzAbsorptionTable::Get()->GetNearestCoefficient(f, 9.894e8) * GetAbsorptionScale(f);
+}
+
 Ptr<SpectrumValue>
 THzSpectrumPropagationLoss::LoadedAbsCoe(int s,
                                          int j,
@@ -207,41 +856,15 @@ THzSpectrumPropagationLoss::LoadedAbsCoe(int s,
                                          double d,
                                          Ptr<const SpectrumValue> txPsd) const
 {
-    std::ifstream AbsCoefile;
-    AbsCoefile.open("contrib/thz/model/data_AbsCoe.txt", std::ifstream::in);
-    if (!AbsCoefile.is_open())
-    {
-        NS_FATAL_ERROR("THzSpectrumPropagationLoss::LoadedAbsCoe: open data_AbsCoe.txt failed");
-    }
-    double k;
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
     Ptr<SpectrumValue> kf_store = Copy<SpectrumValue>(txPsd);
-    int i = 1;
+    int last = std::min(j, static_cast<int>(table->GetSize()));
 
-    while (AbsCoefile >> k)
+    for (int i = std::max(s, 1); i <= last; i++)
     {
-        if (i < s)
-        {
-            i++;
-        }
-        else if (i > j)
-        {
-            break;
-        }
-        else
-        {
-            (*kf_store)[i - s] = k;
-            i++;
-        }
+        (*kf_store)[i - s] = table->GetCoefficient(i - 1);
     }
     return kf_store;
 }
 
-bool
-THzSpectrumPropagationLoss::mapContainsKey(std::map<double, double>& map, double key)
-{
-    if (map.find(key) == map.end())
-        return false;
-    return true;
-}
-
 } // namespace ns3
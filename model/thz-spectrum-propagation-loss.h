@@ -24,13 +24,18 @@
 #ifndef THZ_SPECTRUM_PROPAGATION_LOSS_H
 #define THZ_SPECTRUM_PROPAGATION_LOSS_H
 
+#include "thz-absorption-table.h"
 #include "thz-spectrum-signal-parameters.h"
+#include "thz-worker-pool.h"
 
 #include <ns3/mobility-model.h>
 #include <ns3/object.h>
+#include <ns3/simple-ref-count.h>
 #include <ns3/spectrum-value.h>
 
 #include <map>
+#include <string>
+#include <vector>
 
 namespace ns3
 {
@@ -39,13 +44,110 @@ namespace ns3
  *
  */
 
+/**
+ * \brief Per-band constants of a SpectrumModel used by the received power computation.
+ *
+ * With these, the received power of band i at distance d is
+ * psd[i] * invSpread[i] * exp(-kf[i] * d) / d^2.
+ */
+struct THzBandCoefficients : public SimpleRefCount<THzBandCoefficients>
+{
+    std::vector<double> kf;        //!< absorption coefficient of each band
+    std::vector<double> invSpread; //!< (c / (4 pi fc))^2 of each band, the inverse spreading loss at 1 m
+    bool preset; //!< the bands are those of a THzBandPreset, summed by the fixed-size kernel
+};
+
+/**
+ * \brief Integrated received PSD of one transmit PSD tabulated over distance.
+ *
+ * Holds ln(sum over bands of psd[i] * invSpread[i] * exp(-kf[i] * d)) on a grid that is
+ * logarithmic in distance, with a number of points chosen per decade so that linear
+ * interpolation stays within a given error. A lookup costs the same whatever the number of
+ * bands of the PSD.
+ */
+struct THzPathGainTable : public SimpleRefCount<THzPathGainTable>
+{
+    /**
+     * \param d the distance, unit in meter.
+     * \param sum set to the interpolated sum over bands, without the 1/d^2 factor.
+     *
+     * \return false if d is outside the tabulated distances.
+     */
+    bool Interpolate(double d, double& sum) const;
+
+    double logDistanceMin;              //!< ln of the first tabulated distance (m)
+    std::vector<uint32_t> decadeOffset; //!< index in logSum of the first point of each decade
+    std::vector<uint32_t> decadePoints; //!< number of intervals of each decade
+    std::vector<double> logSum;         //!< ln of the sum over bands at each point
+};
+
 class THzSpectrumPropagationLoss : public Object
 {
   public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
     THzSpectrumPropagationLoss();
     virtual ~THzSpectrumPropagationLoss();
 
-    virtual bool mapContainsKey(std::map<double, double>& map, double key);
+    /**
+     * \brief Use a binary absorption table read block by block instead of the default database.
+     *
+     * \param fileName the binary table, or an empty string for the default database.
+     *
+     * With a table set, the coefficient of each band is interpolated between the grid points
+     * around its center frequency, and only the blocks covering the bands in use are read.
+     * Coefficients already computed for a spectrum model are dropped.
+     */
+    void SetAbsorptionDatabase(std::string fileName);
+
+    /**
+     * \return the binary table set by SetAbsorptionDatabase, or an empty string.
+     */
+    std::string GetAbsorptionDatabase() const;
+
+    /**
+     * \brief Set the atmosphere the absorption coefficients are scaled to.
+     *
+     * \param humidity the relative humidity, unit in percent; a negative value uses the
+     *        coefficients of the database unchanged.
+     * \param temperature the air temperature, unit in Kelvin.
+     * \param pressure the air pressure, water vapor included, unit in Pascal.
+     *
+     * The database describes a reference atmosphere of 10% water vapor molecules at 296 K and
+     * 101325 Pa. The coefficient at each frequency is scaled by the ratio of the water vapor
+     * line-by-line model of ITU-R P.676-12 in the two atmospheres, which accounts for the line
+     * strengths at the temperature and for the line widths broadened by dry air and by water
+     * vapor. The model lists the lines up to 1 THz and a pseudo-line for the continuum above,
+     * so the scale is an extrapolation at higher frequencies.
+     *
+     * The band coefficients of every spectrum model are built once per environment and shared
+     * by all loss models set to it, so switching back to an environment costs nothing.
+     */
+    void SetEnvironment(double humidity, double temperature, double pressure);
+
+    /**
+     * \param f the frequency, unit in Hz.
+     *
+     * \return the factor applied to the absorption coefficient of the database at f for the
+     *         current environment.
+     */
+    double GetAbsorptionScale(double f) const;
+
+    /**
+     * \brief Get the per-band coefficients of a spectrum model.
+     *
+     * \param model the spectrum model of a transmit PSD.
+     *
+     * \return the coefficients of every band of the model, built on the first call for a
+     * given model and cached by its uid afterwards.
+     *
+     * The coefficients are shared by the loss models of the same dynamic type in the same
+     * environment. They are only used for the received power if UseBandCoefficients is true.
+     */
+    Ptr<const THzBandCoefficients> GetBandCoefficients(Ptr<const SpectrumModel> model);
 
     /**
      * \param txPsd the power spectral density of the transmitted signal, unit in Watt.
@@ -75,6 +177,76 @@ class THzSpectrumPropagationLoss : public Object
                                  Ptr<MobilityModel> b,
                                  double RxTxGainDb);
 
+    /**
+     * \brief Compute the received power of one transmission at many receivers.
+     *
+     * \param txParams the data structure of the transmitted signal.
+     * \param distance the distance to each receiver, unit in meter.
+     * \param RxTxGainDb the total antenna gain towards each receiver, unit in dB.
+     * \param rxPowerDbm filled with the received power at each receiver, unit in dBm.
+     *
+     * Gives the same result as calling CalcRxPowerDA once per receiver, but walks the bands
+     * once for all receivers and allocates nothing once rxPowerDbm has reached its size.
+     */
+    void CalcRxPowerDABatch(Ptr<THzSpectrumSignalParameters> txParams,
+                            const std::vector<double>& distance,
+                            const std::vector<double>& RxTxGainDb,
+                            std::vector<double>& rxPowerDbm);
+
+    /**
+     * \brief Compute the antenna-independent part of the received power at many receivers.
+     *
+     * \param txParams the data structure of the transmitted signal.
+     * \param distance the distance to each receiver, unit in meter.
+     * \param pathGain filled with the received power at each receiver for a total antenna gain
+     *        of 0 dB, unit in Watt.
+     * \param pool if given, large batches are split over its threads by receiver.
+     *
+     * The path gain only depends on the transmit PSD and the distance, so it can be cached for
+     * static node pairs and turned into a received power with CalcRxPowerDbm. Each receiver is
+     * summed in the same order whichever thread computes it, so the result does not depend on
+     * the pool.
+     */
+    void CalcPathGainBatch(Ptr<THzSpectrumSignalParameters> txParams,
+                           const std::vector<double>& distance,
+                           std::vector<double>& pathGain,
+                           Ptr<THzWorkerPool> pool = 0);
+
+    /**
+     * \brief Get the path gain table of a transmit PSD.
+     *
+     * \param txPsd the transmit PSD.
+     *
+     * \return the table of txPsd for the current band coefficients, built on the first call and
+     *         shared afterwards by every transmitter using the same PSD.
+     */
+    Ptr<const THzPathGainTable> GetPathGainTable(Ptr<const SpectrumValue> txPsd);
+
+    /**
+     * \param pathGain the received power for a total antenna gain of 0 dB, unit in Watt.
+     * \param RxTxGainDb the total antenna gain of both transmitter and receiver, unit in dB.
+     *
+     * \return the received signal power, unit in dBm.
+     */
+    double CalcRxPowerDbm(double pathGain, double RxTxGainDb) const;
+
+    /**
+     * \brief Upper bound on the distance at which a transmission can still be received.
+     *
+     * \param txParams the data structure of the transmitted signal.
+     * \param maxGainDb the largest total antenna gain any receiver can see, unit in dB.
+     * \param thresholdDbm the received power below which a receiver can be ignored, unit in dBm.
+     *
+     * \return the distance beyond which the received power is below thresholdDbm, unit in meter.
+     *
+     * The bound ignores the molecular absorption, which can only lower the received power, so
+     * it never excludes a receiver that CalcRxPowerDA would place above the threshold. Without
+     * UseBandCoefficients there is no bound and the distance is infinite.
+     */
+    double CalcMaxRange(Ptr<THzSpectrumSignalParameters> txParams,
+                        double maxGainDb,
+                        double thresholdDbm);
+
     /**
      * \brief Calculate the spreading loss
      *
@@ -105,10 +277,20 @@ class THzSpectrumPropagationLoss : public Object
      * Transactions on Wireless Communications, vol. 10, no. 10, pp. 3211,
      * 3221, Oct. 2011.
      *
-     * The values of f and d are collected from HITRAN database.
+     * The values of f and d are collected from HITRAN database. The coefficient is read
+     * from the process-wide THzAbsorptionTable instead of rescanning the database files,
+     * or from the table set by SetAbsorptionDatabase.
      */
     virtual double CalculateAbsLoss(double f, double d);
 
+    /**
+     * \param f the central frequency of the operation subband, unit in Hz.
+     *
+     * \return the molecular absorption coefficient at f in the current environment,
+     *         unit in 1/m.
+     */
+    virtual double GetAbsorptionCoefficient(double f) const;
+
     /**
      * \param s the starting boundary of the absorption coefficent.
      * \param j the ending boundary of the absorption coefficent.
@@ -126,9 +308,126 @@ class THzSpectrumPropagationLoss : public Object
                                             double d,
                                             Ptr<const SpectrumValue> txPsd) const;
 
+    /**
+     * \return true if the loss of every band is the spreading loss of THzSpectrumPropagationLoss
+     *         times exp(GetAbsorptionCoefficient(f) * d), so the received power can be computed
+     *         from the band coefficients.
+     *
+     * This is only assumed for THzSpectrumPropagationLoss itself. For a subclass, the received
+     * power calls CalculateSpreadLoss and CalculateAbsLoss for every band, so their overrides
+     * take effect; a subclass overriding neither, or only GetAbsorptionCoefficient, can return
+     * true to keep the fast paths.
+     */
+    virtual bool UseBandCoefficients() const;
+
     double m_previousFc;
     double m_kf;
-    std::map<double, double> m_freqMap;
+
+  private:
+    /**
+     * \param txPsd the power spectral density of the transmitted signal, unit in Watt.
+     * \param coe the band coefficients of the spectrum model of txPsd.
+     * \param d the distance between transmitter and receiver, unit in meter.
+     *
+     * \return the sum over all bands of the received power spectral density.
+     */
+    double IntegrateRxPsd(const SpectrumValue& txPsd, const THzBandCoefficients& coe, double d) const;
+
+    /**
+     * \param txPsd the power spectral density of the transmitted signal, unit in Watt.
+     * \param d the distance between transmitter and receiver, unit in meter.
+     *
+     * \return the sum over all bands of the received power spectral density, with the losses
+     *         of CalculateSpreadLoss and CalculateAbsLoss.
+     */
+    double IntegrateRxPsdPerBand(const SpectrumValue& txPsd, double d);
+
+    /**
+     * \brief Path gain kernel of CalcPathGainBatch over a contiguous range of receivers.
+     *
+     * \param psd the transmit PSD of every band.
+     * \param coe the band coefficients of the spectrum model of psd.
+     * \param d the distance to each receiver, unit in meter.
+     * \param acc zero-filled on entry, the path gain of each receiver on return.
+     * \param nRx the number of receivers.
+     * \param sbw the sub-band bandwidth, unit in Hz.
+     * \param ratio the number of sub-bands over the number of samples.
+     */
+    void CalcPathGainRange(const double* psd,
+                           const THzBandCoefficients& coe,
+                           const double* d,
+                           double* acc,
+                           std::size_t nRx,
+                           double sbw,
+                           double ratio) const;
+
+    std::string m_databaseFile;                       //!< binary table set by the user, if any
+    Ptr<const THzPagedAbsorptionTable> m_database;    //!< table of m_databaseFile
+
+    /// band coefficients of each spectrum model, by model uid
+    typedef std::map<SpectrumModelUid_t, Ptr<const THzBandCoefficients>> BandCoefficientMap;
+
+    /**
+     * \brief Select the band coefficients of the current database and environment.
+     *
+     * The coefficients are kept in a process-wide registry keyed by the database and the
+     * environment, so they are built once for every loss model using the same atmosphere.
+     */
+    void UpdateEnvironment();
+
+    /// Accessors of the environment attributes
+    void SetHumidity(double humidity);
+    double GetHumidity() const;
+    void SetTemperature(double temperature);
+    double GetTemperature() const;
+    void SetPressure(double pressure);
+    double GetPressure() const;
+
+    /**
+     * \param psd the transmit PSD of every band.
+     * \param coe the band coefficients of the spectrum model of psd.
+     * \param d the distance, unit in meter.
+     *
+     * \return the natural logarithm of the sum over bands of the received PSD at d, times d^2.
+     */
+    double CalcLogSum(const double* psd, const THzBandCoefficients& coe, double d) const;
+
+    /**
+     * \param d the distance to each receiver, unit in meter.
+     * \param psd the transmit PSD of every band.
+     * \param coe the band coefficients of the spectrum model of psd.
+     * \param sum filled with the sum over bands at each distance, without the 1/d^2 factor.
+     *
+     * Uses the path gain table of the PSD for the distances it covers.
+     */
+    void LookupSums(Ptr<const SpectrumValue> txPsd,
+                    const THzBandCoefficients& coe,
+                    const double* d,
+                    double* sum,
+                    std::size_t nRx);
+
+    /// Setter of the PathGainTableMaxError attribute
+    void SetPathGainTableMaxError(double maxError);
+    /// Getter of the PathGainTableMaxError attribute
+    double GetPathGainTableMaxError() const;
+
+    /// path gain table of each transmit PSD and band coefficients it was built with
+    typedef std::map<std::pair<Ptr<const SpectrumValue>, Ptr<const THzBandCoefficients>>,
+                     Ptr<const THzPathGainTable>>
+        PathGainTableMap;
+
+    bool m_pathGainTableEnabled;       //!< look path gains up in tables instead of summing bands
+    double m_pathGainTableMaxError;    //!< largest interpolation error of the tables (dB)
+    PathGainTableMap m_pathGainTables; //!< tables built so far
+
+    double m_humidity;        //!< relative humidity, unit in percent, negative for the database
+    double m_temperature;     //!< air temperature, unit in Kelvin
+    double m_pressure;        //!< air pressure, unit in Pascal
+    double m_vaporPressure;   //!< partial pressure of water vapor, unit in Pascal
+
+    BandCoefficientMap* m_bandCoefficients; //!< coefficients of the current environment
+    SpectrumModelUid_t m_lastUid;                      //!< uid of the last model looked up
+    Ptr<const THzBandCoefficients> m_lastCoefficients; //!< coefficients of the last model looked up
 };
 
 } // namespace ns3
@@ -53,7 +53,7 @@ struct THzSpectrumSignalParameters : public SpectrumSignalParameters
     /**
      * The power spectral density of the transmitted signal.
      */
-    Ptr<SpectrumValue> txPsd;
+    Ptr<const SpectrumValue> txPsd;
 
     /**
      * The duration of the packet transmission.
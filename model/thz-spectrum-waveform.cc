@@ -22,15 +22,26 @@
 
 #include "thz-spectrum-waveform.h"
 
+#include "thz-absorption-table.h"
+#include "thz-band-presets.h"
+
 #include "ns3/log.h"
+#include <ns3/boolean.h>
 #include <ns3/core-module.h>
 #include <ns3/object.h>
+#include <ns3/string.h>
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <vector>
 
 NS_LOG_COMPONENT_DEFINE("THzSpectrumValueFactory");
 
@@ -39,6 +50,109 @@ namespace ns3
 const double PULSE_START_FREQUENCY = 0.1e12; // Hz
 const double PULSE_END_FREQUENCY = 4e12;
 
+namespace
+{
+/**
+ * Attributes and arguments a transmit PSD of THzSpectrumValueFactory depends on.
+ */
+struct PsdKey
+{
+    bool pulse;       //!< pulse PSD of the nano PHY instead of the flat PSD of the macro PHY
+    double fc;        //!< CentralFrequency
+    double tbw;       //!< TotalBandWidth
+    double sbw;       //!< SubBandWidth
+    int numsb;        //!< NumSubBand
+    int numsample;    //!< NumSample
+    double txPower;   //!< transmission power (W)
+    double n;         //!< order of derivative of the Gaussian pulse
+    double r;         //!< standard deviation of the Gaussian pulse
+    bool analytic;    //!< AnalyticPulseNormalization
+    double tolerance; //!< AdaptiveSamplingTolerance
+    double distance;  //!< AdaptiveSamplingDistance
+
+    bool operator<(const PsdKey& o) const
+    {
+        return std::tie(pulse, fc, tbw, sbw, numsb, numsample, txPower, n, r, analytic, tolerance,
+                        distance) <
+               std::tie(o.pulse,
+                        o.fc,
+                        o.tbw,
+                        o.sbw,
+                        o.numsb,
+                        o.numsample,
+                        o.txPower,
+                        o.n,
+                        o.r,
+                        o.analytic,
+                        o.tolerance,
+                        o.distance);
+    }
+};
+
+/**
+ * A shared transmit PSD and the factory state left by building it.
+ */
+struct PsdEntry
+{
+    Ptr<const SpectrumValue> psd;
+    int numsb;
+    double fstart;
+    Ptr<SpectrumModel> waveform;
+    Ptr<SpectrumModel> allWaveform;
+    Ptr<SpectrumModel> pulseWaveform;
+};
+
+/**
+ * \return the process-wide cache of transmit PSDs.
+ */
+std::map<PsdKey, PsdEntry>&
+GetPsdCache()
+{
+    static std::map<PsdKey, PsdEntry> cache;
+    return cache;
+}
+/**
+ * PSD mask exports written by background threads, completed at exit at the latest.
+ */
+struct MaskExports
+{
+    ~MaskExports()
+    {
+        Flush();
+    }
+
+    void Flush()
+    {
+        // waited without the lock, as a failed export takes it to forget its content
+        std::map<std::string, std::future<void>> flushed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushed.swap(pending);
+        }
+        for (std::map<std::string, std::future<void>>::iterator it = flushed.begin();
+             it != flushed.end();
+             ++it)
+        {
+            it->second.wait();
+        }
+    }
+
+    std::mutex mutex;
+    std::map<std::string, std::future<void>> pending; //!< last export started to each file
+    std::map<std::string, std::string> written;       //!< last content exported to each file
+};
+
+/**
+ * \return the process-wide PSD mask exports.
+ */
+MaskExports&
+GetMaskExports()
+{
+    static MaskExports exports;
+    return exports;
+}
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(THzSpectrumValueFactory);
 
 TypeId
@@ -71,11 +185,40 @@ THzSpectrumValueFactory::GetTypeId()
                           "The number of sample bands of the selected 3dB frequency window",
                           DoubleValue(100),
                           MakeDoubleAccessor(&THzSpectrumValueFactory::m_numsample),
-                          MakeDoubleChecker<int>());
+                          MakeDoubleChecker<int>())
+            .AddAttribute("AnalyticPulseNormalization",
+                          "If true, the energy of the Gaussian pulse is normalized with its "
+                          "closed form over all frequencies instead of a sum over the sample "
+                          "bands",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&THzSpectrumValueFactory::m_analyticPulse),
+                          MakeBooleanChecker())
+            .AddAttribute("PsdMaskFile",
+                          "File the PSD mask is written to by CreateTxPowerSpectralDensityMask, "
+                          "in the background. Empty to not export the mask.",
+                          StringValue(""),
+                          MakeStringAccessor(&THzSpectrumValueFactory::m_psdMaskFile),
+                          MakeStringChecker())
+            .AddAttribute("AdaptiveSamplingTolerance",
+                          "Largest error of the band-averaged transmittance allowed by the "
+                          "adaptive band layout of CreateTxPowerSpectralDensity. 0 for NumSample "
+                          "uniform bands.",
+                          DoubleValue(0),
+                          MakeDoubleAccessor(&THzSpectrumValueFactory::m_adaptiveTolerance),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("AdaptiveSamplingDistance",
+                          "Distance (m) at which the transmittance of the adaptive band layout is "
+                          "evaluated",
+                          DoubleValue(1),
+                          MakeDoubleAccessor(&THzSpectrumValueFactory::m_adaptiveDistance),
+                          MakeDoubleChecker<double>(0));
     return tid;
 }
 
 THzSpectrumValueFactory::THzSpectrumValueFactory()
+    : m_analyticPulse(false),
+      m_adaptiveTolerance(0),
+      m_adaptiveDistance(1)
 {
 }
 
@@ -90,27 +233,7 @@ THzSpectrumValueFactory::THzSpectrumWaveformInitializer()
     m_fstart = m_fc - (m_numsb / 2) * m_sbw;
     NS_LOG_DEBUG("CHECK: THzSpectrumWaveformInitializer: m_numsb = " << m_numsb);
 
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::THzSpectrumWaveformInitializer: open data_frequency.txt failed");
-    }
-
-    double f_starV; // Detected frequency from the frequency database
-    double f;
-    while (frequencyfile >> f)
-    {
-        if (f < m_fstart)
-        {
-        }
-        else
-        {
-            break; // if customer defined value is not corresponding to any value stored in database
-        }
-        // just select the first value next to the customer defined frequency
-    }
-    f_starV = f;
+    double f_starV = FreqStartValue(); // Detected frequency from the frequency database
 
     Bands bands;
 
@@ -129,20 +252,7 @@ THzSpectrumValueFactory::THzSpectrumWaveformInitializer()
 Ptr<SpectrumModel>
 THzSpectrumValueFactory::AllTHzSpectrumWaveformInitializer()
 {
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::AllTHzSpectrumWaveformInitializer: open data_frequency.txt failed");
-    }
-
-    double f;
-    int i = 0;
-
-    while (frequencyfile >> f)
-    {
-        i++;
-    }
+    int i = THzAbsorptionTable::Get()->GetSize();
     Bands bands;
 
     for (int j = 0; j <= i; j++)
@@ -160,13 +270,6 @@ THzSpectrumValueFactory::AllTHzSpectrumWaveformInitializer()
 Ptr<SpectrumModel>
 THzSpectrumValueFactory::THzPulseSpectrumWaveformInitializer()
 {
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::THzPulseSpectrumWaveformInitializer: open data_frequency.txt failed");
-    }
-
     Bands bands;
     double pulseStartingSample = PULSE_START_FREQUENCY / m_sbw;
     m_numsb = (PULSE_END_FREQUENCY - PULSE_START_FREQUENCY) / m_sbw;
@@ -192,66 +295,29 @@ THzSpectrumValueFactory::BandNum()
 int
 THzSpectrumValueFactory::FreqSeqStart() // return sequence number of the first frequency band
 {
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::FreqSeqStart: open data_frequency.txt failed");
-    }
-
-    double f;
-    int i = 1;
-    while (frequencyfile >> f)
-    {
-        if (f < m_fstart)
-        {
-            i++;
-        }
-        else
-        {
-            break;
-        }
-    }
-
-    return i;
+    // the grid is sorted, so every frequency below m_fstart comes first
+    return THzAbsorptionTable::Get()->FindFrequency(m_fstart) + 1;
 }
 
 double
 THzSpectrumValueFactory::FreqStartValue()
 {
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::FreqStartValue: open data_frequency.txt failed");
-    }
-
-    double f;
-    while (frequencyfile >> f)
-    {
-        if (f >= m_fstart)
-        {
-            break;
-        }
-    }
-    return f;
+    // the first frequency not below m_fstart, or the last one of the database
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
+    uint32_t i = std::min(table->FindFrequency(m_fstart), table->GetSize() - 1);
+    return table->GetFrequency(i);
 }
 
 Ptr<SpectrumValue>
 THzSpectrumValueFactory::FreqBands()
 {
     Ptr<SpectrumValue> f_store = Create<SpectrumValue>(m_THzSpectrumWaveform);
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::FreqBands: open data_frequency.txt failed");
-    }
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
 
-    double f;
     int i = 0;
-    while (frequencyfile >> f)
+    for (uint32_t k = 0; k < table->GetSize(); k++)
     {
+        double f = table->GetFrequency(k);
         (*f_store)[i] = f;
 
         if (f >= m_fstart)
@@ -270,29 +336,14 @@ int
 THzSpectrumValueFactory::FreqSeqEnd() // return the sequence number of the last frequency band
 {
     Ptr<SpectrumValue> f_store = Create<SpectrumValue>(m_THzSpectrumWaveform);
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::FreqSeqEnd: open data_frequency.txt failed");
-    }
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
 
-    double f;
+    // skip the frequencies below m_fstart and the first one above it
     int i = 0;
-    int j = 0;
-    while (frequencyfile >> f)
-    {
-        if (f < m_fstart)
-        {
-            j++;
-        }
-        else
-        {
-            break;
-        }
-    }
-    while (frequencyfile >> f)
+    int j = table->FindFrequency(m_fstart);
+    for (uint32_t k = j + 1; k < table->GetSize(); k++)
     {
+        double f = table->GetFrequency(k);
         (*f_store)[i] = f;
 
         if (f >= m_fstart)
@@ -307,6 +358,66 @@ THzSpectrumValueFactory::FreqSeqEnd() // return the sequence number of the last
     return i + j;
 }
 
+Ptr<const SpectrumValue>
+THzSpectrumValueFactory::GetTxPowerSpectralDensity(double txPower)
+{
+    PsdKey key = {false,
+                  m_fc,
+                  m_tbw,
+                  m_sbw,
+                  m_numsb,
+                  m_numsample,
+                  txPower,
+                  0,
+                  0,
+                  false,
+                  m_adaptiveTolerance,
+                  m_adaptiveDistance};
+    std::map<PsdKey, PsdEntry>::iterator it = GetPsdCache().find(key);
+    if (it == GetPsdCache().end())
+    {
+        PsdEntry entry;
+        entry.waveform = THzSpectrumWaveformInitializer();
+        entry.allWaveform = AllTHzSpectrumWaveformInitializer();
+        entry.psd = CreateTxPowerSpectralDensity(txPower);
+        entry.numsb = m_numsb;
+        entry.fstart = m_fstart;
+        NS_LOG_INFO("Built the transmit PSD at " << m_fc << " Hz, " << m_tbw << " Hz wide");
+        it = GetPsdCache().insert(std::make_pair(key, entry)).first;
+    }
+    m_numsb = it->second.numsb;
+    m_fstart = it->second.fstart;
+    m_THzSpectrumWaveform = it->second.waveform;
+    m_AllTHzSpectrumWaveform = it->second.allWaveform;
+    return it->second.psd;
+}
+
+Ptr<const SpectrumValue>
+THzSpectrumValueFactory::GetPulsePowerSpectralDensity(double n, double r, double txPowerWatts)
+{
+    PsdKey key =
+        {true, m_fc, m_tbw, m_sbw, m_numsb, m_numsample, txPowerWatts, n, r, m_analyticPulse, 0, 0};
+    std::map<PsdKey, PsdEntry>::iterator it = GetPsdCache().find(key);
+    if (it == GetPsdCache().end())
+    {
+        PsdEntry entry;
+        entry.waveform = THzSpectrumWaveformInitializer();
+        entry.allWaveform = AllTHzSpectrumWaveformInitializer();
+        entry.pulseWaveform = THzPulseSpectrumWaveformInitializer();
+        entry.psd = CreatePulsePowerSpectralDensity(n, r, txPowerWatts);
+        entry.numsb = m_numsb;
+        entry.fstart = m_fstart;
+        NS_LOG_INFO("Built the pulse PSD of " << r << " s pulses");
+        it = GetPsdCache().insert(std::make_pair(key, entry)).first;
+    }
+    m_numsb = it->second.numsb;
+    m_fstart = it->second.fstart;
+    m_THzSpectrumWaveform = it->second.waveform;
+    m_AllTHzSpectrumWaveform = it->second.allWaveform;
+    m_THzPulseSpectrumWaveform = it->second.pulseWaveform;
+    return it->second.psd;
+}
+
 Ptr<SpectrumValue>
 THzSpectrumValueFactory::CreateConstant(double v)
 {
@@ -318,52 +429,171 @@ THzSpectrumValueFactory::CreateConstant(double v)
 Ptr<SpectrumValue>
 THzSpectrumValueFactory::CreateTxPowerSpectralDensity(double txPower)
 {
-    std::ifstream frequencyfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
+    double f_starV = FreqStartValue();
+
+    Bands bands;
+
+    m_numsb = m_tbw / m_sbw;
+
+    // nominal width of a sample band, as integrated by the channel
+    double width = m_sbw * (static_cast<double>(m_numsb) / m_numsample);
+    if (m_adaptiveTolerance > 0)
     {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::CreateTxPowerSpectralDensity: open data_frequency.txt failed");
+        BuildAdaptiveBands(f_starV - 0.5 * m_sbw, width, m_numsample, bands);
     }
+    else if (const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>* edges = GetPresetEdges())
+    {
+        // the same edges as below, computed at compile time
+        bands.resize(THZ_PRESET_NUM_SAMPLE);
+        for (uint32_t j = 0; j < THZ_PRESET_NUM_SAMPLE; j++)
+        {
+            bands[j].fl = f_starV - 0.5 * m_sbw + (*edges)[j];
+            bands[j].fh = f_starV - 0.5 * m_sbw + (*edges)[j + 1];
+            bands[j].fc = (bands[j].fl + bands[j].fh) / 2;
+        }
+    }
+    else
+    {
+        for (int j = 0; j < m_numsample; j++)
+        {
+            BandInfo bi;
+            bi.fl = f_starV - 0.5 * m_sbw + j * m_sbw * (m_numsb / m_numsample);
+            bi.fh = f_starV - 0.5 * m_sbw + (j + 1) * m_sbw * (m_numsb / m_numsample);
+            bi.fc = (bi.fl + bi.fh) / 2;
+            bands.push_back(bi);
+        }
+    }
+
+    NS_LOG_DEBUG("CHECK:CreateTxPowerSpectralDensity: m_numsb = " << m_numsb);
+
+    Ptr<SpectrumModel> txBand = Create<SpectrumModel>(bands);
+    Ptr<SpectrumValue> txPsd = Create<SpectrumValue>(txBand);
+    double txPowerDensity = txPower / m_tbw;
 
-    double f_starV;
-    double f;
-    while (frequencyfile >> f)
+    for (uint32_t g = 0; g < bands.size(); g++)
     {
-        if (f < m_fstart)
+        if (m_adaptiveTolerance > 0)
         {
+            (*txPsd)[g] = txPowerDensity * (bands[g].fh - bands[g].fl) / width;
         }
         else
         {
-            break;
+            (*txPsd)[g] = txPowerDensity;
         }
     }
-    f_starV = f;
-
-    Bands bands;
 
-    m_numsb = m_tbw / m_sbw;
+    return txPsd;
+}
 
-    for (int j = 0; j < m_numsample; j++)
+const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>*
+THzSpectrumValueFactory::GetPresetEdges() const
+{
+    const THzBandPreset* presets[] = {&THZ_PRESET_1_0345_THZ, &THZ_PRESET_802_15_3D};
+    const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>* edges[] = {&THZ_PRESET_1_0345_THZ_EDGES,
+                                                                    &THZ_PRESET_802_15_3D_EDGES};
+    for (std::size_t p = 0; p < 2; p++)
     {
-        BandInfo bi;
-        bi.fl = f_starV - 0.5 * m_sbw + j * m_sbw * (m_numsb / m_numsample);
-        bi.fh = f_starV - 0.5 * m_sbw + (j + 1) * m_sbw * (m_numsb / m_numsample);
-        bi.fc = (bi.fl + bi.fh) / 2;
-        bands.push_back(bi);
+        if (m_fc == presets[p]->centralFrequency && m_tbw == presets[p]->totalBandWidth &&
+            m_sbw == presets[p]->subBandWidth && m_numsample == presets[p]->numSample)
+        {
+            return edges[p];
+        }
     }
+    return 0;
+}
 
-    NS_LOG_DEBUG("CHECK:CreateTxPowerSpectralDensity: m_numsb = " << m_numsb);
+double
+THzSpectrumValueFactory::GetTransmittanceError(double fl, double fh) const
+{
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
+    double center =
+        std::exp(-table->InterpolateCoefficient((fl + fh) / 2) * m_adaptiveDistance);
+
+    // trapezoid over the band edges and every grid point inside the band
+    double f0 = fl;
+    double t0 = std::exp(-table->InterpolateCoefficient(fl) * m_adaptiveDistance);
+    double sum = 0;
+    for (uint32_t i = table->FindFrequency(fl); i < table->GetSize(); i++)
+    {
+        double f1 = std::min(table->GetFrequency(i), fh);
+        double t1 = f1 < fh ? std::exp(-table->GetCoefficient(i) * m_adaptiveDistance)
+                            : std::exp(-table->InterpolateCoefficient(fh) * m_adaptiveDistance);
+        sum += (f1 - f0) * (t0 + t1) / 2;
+        f0 = f1;
+        t0 = t1;
+        if (f1 >= fh)
+        {
+            break;
+        }
+    }
+    if (f0 < fh)
+    {
+        // the band extends past the grid, where the coefficient is clamped to the last point
+        sum += (fh - f0) * t0;
+    }
+    return std::abs(sum / (fh - fl) - center);
+}
 
-    Ptr<SpectrumModel> txBand = Create<SpectrumModel>(bands);
-    Ptr<SpectrumValue> txPsd = Create<SpectrumValue>(txBand);
-    double txPowerDensity = txPower / m_tbw;
+void
+THzSpectrumValueFactory::BuildAdaptiveBands(double fl, double width, int n, Bands& bands) const
+{
+    const int maxDepth = 6; // bands are split down to 1/64 of the uniform width
+    const double maxWidth = 8 * width;
 
-    for (int g = 0; g < m_numsample; g++)
+    // split the uniform bands around absorption lines, depth first to keep them in order
+    std::vector<std::pair<double, double>> split;
+    for (int j = 0; j < n; j++)
     {
-        (*txPsd)[g] = txPowerDensity;
+        std::vector<std::pair<std::pair<double, double>, int>> stack;
+        stack.push_back(std::make_pair(std::make_pair(fl + j * width, fl + (j + 1) * width), 0));
+        while (!stack.empty())
+        {
+            std::pair<double, double> band = stack.back().first;
+            int depth = stack.back().second;
+            stack.pop_back();
+            if (depth < maxDepth && GetTransmittanceError(band.first, band.second) > m_adaptiveTolerance)
+            {
+                double mid = (band.first + band.second) / 2;
+                stack.push_back(std::make_pair(std::make_pair(mid, band.second), depth + 1));
+                stack.push_back(std::make_pair(std::make_pair(band.first, mid), depth + 1));
+            }
+            else
+            {
+                split.push_back(band);
+            }
+        }
     }
 
-    return txPsd;
+    // merge flat neighbors
+    bands.clear();
+    std::pair<double, double> current = split[0];
+    for (std::size_t k = 1; k < split.size(); k++)
+    {
+        if (split[k].second - current.first <= maxWidth &&
+            GetTransmittanceError(current.first, split[k].second) <= m_adaptiveTolerance)
+        {
+            current.second = split[k].second;
+            continue;
+        }
+        BandInfo bi;
+        bi.fl = current.first;
+        bi.fh = current.second;
+        bi.fc = (bi.fl + bi.fh) / 2;
+        bands.push_back(bi);
+        current = split[k];
+    }
+    BandInfo bi;
+    bi.fl = current.first;
+    bi.fh = current.second;
+    bi.fc = (bi.fl + bi.fh) / 2;
+    bands.push_back(bi);
+    NS_LOG_INFO("Adaptive layout of " << bands.size() << " bands instead of " << n);
+}
+
+void
+THzSpectrumValueFactory::FlushPsdMaskExports()
+{
+    GetMaskExports().Flush();
 }
 
 Ptr<SpectrumValue>
@@ -432,23 +662,58 @@ THzSpectrumValueFactory::CreateTxPowerSpectralDensityMask(double txPower)
         (*txPsd)[g12] = txPowerDensity * 1e-4 / m_sbw; // -40dB
     }
 
-    std::stringstream txtname;
-    txtname << "contrib/thz/results/PSD-MASK.txt";
-    std::string filename = txtname.str();
-
-    std::ofstream resultfile;
-    resultfile.open(filename.c_str());
-    resultfile << "txPower: " << std::endl
-               << txPower << std::endl
-               << "PSD: " << std::endl
-               << (*txPsd) << std::endl
-               << "FreqSeqstart: " << std::endl
-               << FreqSeqStart() << std::endl
-               << "FreqSeqEnd: " << std::endl
-               << FreqSeqEnd() << std::endl
-               << " FreqStartValue " << std::endl
-               << FreqStartValue() << std::endl;
-    resultfile.close();
+    if (m_psdMaskFile.empty())
+    {
+        return txPsd;
+    }
+
+    // the content is formatted here, the background thread only writes it out
+    std::stringstream content;
+    content << "txPower: " << std::endl
+            << txPower << std::endl
+            << "PSD: " << std::endl
+            << (*txPsd) << std::endl
+            << "FreqSeqstart: " << std::endl
+            << FreqSeqStart() << std::endl
+            << "FreqSeqEnd: " << std::endl
+            << FreqSeqEnd() << std::endl
+            << " FreqStartValue " << std::endl
+            << FreqStartValue() << std::endl;
+
+    MaskExports& exports = GetMaskExports();
+    std::lock_guard<std::mutex> lock(exports.mutex);
+    std::string& written = exports.written[m_psdMaskFile];
+    if (written == content.str())
+    {
+        return txPsd;
+    }
+    written = content.str();
+    // a file is written by one export at a time: the new export waits for the previous one in
+    // its own thread, so neither the simulation nor the lock waits for the disk
+    std::future<void>& pending = exports.pending[m_psdMaskFile];
+    pending = std::async(std::launch::async,
+                         [&exports,
+                          previous = std::move(pending),
+                          fileName = m_psdMaskFile,
+                          text = written]() {
+                             if (previous.valid())
+                             {
+                                 previous.wait();
+                             }
+                             std::ofstream resultfile(fileName.c_str());
+                             resultfile << text;
+                             if (!resultfile)
+                             {
+                                 // not written, so the same mask is exported again next time
+                                 std::lock_guard<std::mutex> lock(exports.mutex);
+                                 std::string& last = exports.written[fileName];
+                                 if (last == text)
+                                 {
+                                     last.clear();
+                                 }
+                             }
+                         });
+    NS_LOG_INFO("Exporting the PSD mask to " << m_psdMaskFile);
     return txPsd;
 }
 
@@ -457,19 +722,13 @@ THzSpectrumValueFactory::CreateAllPowerSpectralDensity(double n, double r, doubl
 {
     Ptr<SpectrumValue> allPsd = Create<SpectrumValue>(m_AllTHzSpectrumWaveform);
 
-    std::ifstream frequencyfile;
+    Ptr<const THzAbsorptionTable> table = THzAbsorptionTable::Get();
     std::ofstream myfile;
-    frequencyfile.open("contrib/thz/model/data_frequency.txt", std::ifstream::in);
-    if (!frequencyfile.is_open())
-    {
-        NS_LOG_UNCOND("THzSpectrumValueFactory::CreateAllPowerSpectralDensity: open data_frequency.txt failed");
-    }
-    double f;
     int i = 0;
 
-    while (frequencyfile >> f)
+    for (uint32_t k = 0; k < table->GetSize(); k++)
     {
-        double f1 = f / 1e12;
+        double f1 = table->GetFrequency(k) / 1e12;
         (*allPsd)[i] = std::pow((2 * M_PI * f1), (2 * n)) * std::pow(a0, 2) *
                        std::exp(-std::pow((2 * M_PI * f1), 2) * r);
         myfile << (*allPsd)[i] << std::endl;
@@ -483,20 +742,24 @@ double
 THzSpectrumValueFactory::CalculateEnergyConstant(double n, double r, double txPowerWatts) const
 {
     NS_LOG_FUNCTION("");
-    Ptr<SpectrumValue> allPsd = Create<SpectrumValue>(m_THzPulseSpectrumWaveform);
-
-    Bands::const_iterator fit = allPsd->ConstBandsBegin();
+    if (m_analyticPulse)
+    {
+        // Gamma(n + 1/2) / (4 pi r^(2n + 1)), in logarithms as r^(2n + 1) quickly underflows
+        double logEnergy = std::lgamma(n + 0.5) - std::log(4 * M_PI) - (2 * n + 1) * std::log(r);
+        double a02 = txPowerWatts * std::exp(-logEnergy);
+        NS_LOG_INFO("value of a0:" << a02);
+        return a02;
+    }
 
     double integral = 0.0;
     int i = 0;
-    while (fit != allPsd->ConstBandsEnd())
+    for (Bands::const_iterator fit = m_THzPulseSpectrumWaveform->Begin();
+         fit != m_THzPulseSpectrumWaveform->End();
+         ++fit)
     {
-        (*allPsd)[i] = std::pow((2 * M_PI * fit->fc), (2 * n)) *
-                       std::exp(-std::pow((2 * M_PI * fit->fc * r), 2));
-
-        integral += (*allPsd)[i];
+        integral += std::pow((2 * M_PI * fit->fc), (2 * n)) *
+                    std::exp(-std::pow((2 * M_PI * fit->fc * r), 2));
         i++;
-        ++fit;
     }
     NS_LOG_INFO("value of i:" << i);
     integral *= m_sbw * (m_numsb / m_numsample);
@@ -513,18 +776,35 @@ THzSpectrumValueFactory::CreatePulsePowerSpectralDensity(double n,
     NS_LOG_FUNCTION("tx power" << txPowerWatts);
     Ptr<SpectrumValue> allPsd = Create<SpectrumValue>(m_THzPulseSpectrumWaveform);
 
-    Bands::const_iterator fit = allPsd->ConstBandsBegin();
-    double txPsd_inte = 0.0;
+    // one pass evaluates the pulse shape of every band; the normalization below reuses it
+    // instead of evaluating it again in CalculateEnergyConstant
+    std::vector<double> gaussian(allPsd->GetValuesN());
+    double integral = 0.0;
     int i = 0;
+    for (Bands::const_iterator fit = allPsd->ConstBandsBegin(); fit != allPsd->ConstBandsEnd();
+         ++fit, ++i)
+    {
+        (*allPsd)[i] = std::pow((2 * M_PI * fit->fc), (2 * n));
+        gaussian[i] = std::exp(-std::pow((2 * M_PI * fit->fc * r), 2));
+        integral += (*allPsd)[i] * gaussian[i];
+    }
+
+    double a02;
+    if (m_analyticPulse)
+    {
+        a02 = CalculateEnergyConstant(n, r, txPowerWatts);
+    }
+    else
+    {
+        integral *= m_sbw * (m_numsb / m_numsample);
+        a02 = txPowerWatts / integral;
+    }
 
-    double a02 = CalculateEnergyConstant(n, r, txPowerWatts);
-    while (fit != allPsd->ConstBandsEnd())
+    double txPsd_inte = 0.0;
+    for (i = 0; i < static_cast<int>(gaussian.size()); i++)
     {
-        (*allPsd)[i] = std::pow((2 * M_PI * fit->fc), (2 * n)) * a02 *
-                       std::exp(-std::pow((2 * M_PI * fit->fc * r), 2));
+        (*allPsd)[i] = (*allPsd)[i] * a02 * gaussian[i];
         txPsd_inte += (*allPsd)[i];
-        i++;
-        ++fit;
     }
     double txPower = txPsd_inte * m_sbw * (m_numsb / m_numsample);
     NS_LOG_UNCOND("tx power from PSD" << txPower);
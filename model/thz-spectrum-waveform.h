@@ -22,9 +22,14 @@
 #ifndef THZ_SPECTRUM_WAVEFORM_H
 #define THZ_SPECTRUM_WAVEFORM_H
 
+#include "thz-band-presets.h"
+
 #include <ns3/object.h>
 #include <ns3/spectrum-value.h>
 
+#include <array>
+#include <string>
+
 namespace ns3
 {
 class THzSpectrumValueFactory : public Object
@@ -79,15 +84,67 @@ class THzSpectrumValueFactory : public Object
      * \param txPower transmission power
      *
      * \return power spectral density with given transmission power and frequency band information
+     *
+     * With AdaptiveSamplingTolerance, the bands are laid out by BuildAdaptiveBands and each value
+     * holds the power of its band divided by the nominal sample width SubBandWidth * NumSubBand /
+     * NumSample, so the channel integrates it as it does the uniform layout.
      */
     virtual Ptr<SpectrumValue> CreateTxPowerSpectralDensity(double txPower);
 
+    /**
+     * \brief Lay out bands more densely around absorption lines than over flat regions.
+     *
+     * \param fl the lower edge of the first band, unit in Hz.
+     * \param width the width of the bands of the uniform layout, unit in Hz.
+     * \param n the number of bands of the uniform layout.
+     * \param bands filled with the adaptive layout of the same frequency range.
+     *
+     * Starting from the uniform layout, a band is split in two while the transmittance
+     * exp(-kf * d) at AdaptiveSamplingDistance, averaged over the band, differs from its value
+     * at the band center by more than AdaptiveSamplingTolerance. Neighboring bands are then
+     * merged, up to 8 uniform widths, while the merged band stays within the tolerance.
+     */
+    void BuildAdaptiveBands(double fl, double width, int n, Bands& bands) const;
+
+    /**
+     * \param txPower transmission power
+     *
+     * \return the power spectral density of CreateTxPowerSpectralDensity, built after both
+     * waveform initializers.
+     *
+     * The PSD is built once per process for each combination of the factory attributes and
+     * txPower and shared by every caller afterwards, hence handed out read-only; callers that
+     * need a modified PSD work on a Copy(). The factory is left in the same state as if it had
+     * built the PSD itself.
+     */
+    Ptr<const SpectrumValue> GetTxPowerSpectralDensity(double txPower);
+
+    /**
+     * \param n order of derivative of the Gaussian pulse
+     * \param r standard deviation of the Gaussian pulse
+     * \param txPowerWatts transmission power
+     *
+     * \return the power spectral density of CreatePulsePowerSpectralDensity, built after the
+     * three waveform initializers, shared in the same way as GetTxPowerSpectralDensity.
+     */
+    Ptr<const SpectrumValue> GetPulsePowerSpectralDensity(double n, double r, double txPowerWatts);
+
     /**
      * \param txPower transmission power
      *
      * \return masked power spectral density with given transmission power and total bandwidth
+     *
+     * If PsdMaskFile is set, the mask is also written to that file by a background thread.
+     * A mask identical to the last one written to the same file is not written again.
      */
     virtual Ptr<SpectrumValue> CreateTxPowerSpectralDensityMask(double txPower);
+
+    /**
+     * \brief Wait until every PSD mask export started so far has been written.
+     *
+     * Pending exports are also completed when the program exits.
+     */
+    static void FlushPsdMaskExports();
     /**
      * \param n order of derivative of the Gaussian pulse
      * \param r standard deviation of the Gaussian pulse
@@ -112,6 +169,10 @@ class THzSpectrumValueFactory : public Object
      * \param txPowerWatts transmission power
      *
      * \return value of the normalizing constant for the Gaussian pulse
+     *
+     * The energy of the pulse is summed over the bands of the pulse waveform, or, with
+     * AnalyticPulseNormalization, taken from the closed form over all frequencies:
+     * integral of (2 pi f)^(2n) exp(-(2 pi f r)^2) df = Gamma(n + 1/2) / (4 pi r^(2n + 1)).
      */
     virtual double CalculateEnergyConstant(double n, double r, double txPowerWatts) const;
     // private:
@@ -120,11 +181,32 @@ class THzSpectrumValueFactory : public Object
     double m_tbw;    // TotalBandWidth
     double m_fc;     // CentralFrequency
     int m_numsample; // NumSample
+    bool m_analyticPulse; // AnalyticPulseNormalization
+    std::string m_psdMaskFile; // PsdMaskFile
+    double m_adaptiveTolerance; // AdaptiveSamplingTolerance
+    double m_adaptiveDistance;  // AdaptiveSamplingDistance
 
     double m_fstart; // StartingFrequency
     Ptr<SpectrumModel> m_THzSpectrumWaveform;
     Ptr<SpectrumModel> m_AllTHzSpectrumWaveform;
     Ptr<SpectrumModel> m_THzPulseSpectrumWaveform;
+
+  private:
+    /**
+     * \return the compile-time band edges of the preset matching the factory attributes, or 0.
+     */
+    const std::array<double, THZ_PRESET_NUM_SAMPLE + 1>* GetPresetEdges() const;
+
+    /**
+     * \param fl the lower edge of the band, unit in Hz.
+     * \param fh the upper edge of the band, unit in Hz.
+     *
+     * \return the difference between the transmittance at the band center and its average over
+     *         the band, at AdaptiveSamplingDistance. The average is a trapezoid over the band
+     *         edges and the grid points of the absorption table inside the band, with the
+     *         coefficients interpolated linearly between grid points.
+     */
+    double GetTransmittanceError(double fl, double fh) const;
 };
 
 } // namespace ns3
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "thz-worker-pool.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+
+NS_LOG_COMPONENT_DEFINE("THzWorkerPool");
+
+namespace ns3
+{
+
+THzWorkerPool::THzWorkerPool(uint32_t nThreads)
+    : m_job(0),
+      m_generation(0),
+      m_pending(0),
+      m_stop(false)
+{
+    NS_ASSERT(nThreads > 0);
+    for (uint32_t i = 1; i < nThreads; i++)
+    {
+        m_workers.push_back(std::thread(&THzWorkerPool::Work, this, i));
+    }
+    NS_LOG_INFO("Started " << m_workers.size() << " worker threads");
+}
+
+THzWorkerPool::~THzWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (std::size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+}
+
+uint32_t
+THzWorkerPool::GetNThreads() const
+{
+    return m_workers.size() + 1;
+}
+
+void
+THzWorkerPool::Run(const std::function<void(uint32_t)>& part)
+{
+    if (m_workers.empty())
+    {
+        part(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &part;
+        m_pending = m_workers.size();
+        m_generation++;
+    }
+    m_start.notify_all();
+    part(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+    m_job = 0;
+}
+
+void
+THzWorkerPool::Work(uint32_t index)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        const std::function<void(uint32_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+            if (m_stop)
+            {
+                return;
+            }
+            seen = m_generation;
+            job = m_job;
+        }
+        (*job)(index);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending--;
+        }
+        m_done.notify_one();
+    }
+}
+
+} // namespace ns3
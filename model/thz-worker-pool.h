@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#ifndef THZ_WORKER_POOL_H
+#define THZ_WORKER_POOL_H
+
+#include <ns3/simple-ref-count.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup thz
+ * \brief Fixed pool of worker threads running one statically partitioned job at a time.
+ *
+ * The calling thread runs the first part of each job itself and returns once every part is
+ * done. Jobs must not touch ns-3 objects whose reference count or state they share with the
+ * simulation thread; they are meant for number crunching on plain arrays.
+ */
+class THzWorkerPool : public SimpleRefCount<THzWorkerPool>
+{
+  public:
+    /**
+     * \param nThreads the number of threads working on each job, including the caller.
+     */
+    THzWorkerPool(uint32_t nThreads);
+    ~THzWorkerPool();
+
+    /**
+     * \return the number of threads working on each job, including the caller.
+     */
+    uint32_t GetNThreads() const;
+
+    /**
+     * \brief Run a job split in GetNThreads () parts and wait for all of them.
+     *
+     * \param part called once with every part index in [0, GetNThreads ()).
+     */
+    void Run(const std::function<void(uint32_t)>& part);
+
+  private:
+    /**
+     * \param index the part index served by this worker.
+     */
+    void Work(uint32_t index);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start; //!< signals a new job or the shutdown to the workers
+    std::condition_variable m_done;  //!< signals the caller that a worker finished its part
+    const std::function<void(uint32_t)>* m_job; //!< the current job
+    uint64_t m_generation;                      //!< number of jobs started so far
+    uint32_t m_pending;                         //!< workers still running the current job
+    bool m_stop;
+};
+
+} // namespace ns3
+
+#endif /* THZ_WORKER_POOL_H */
@@ -0,0 +1,171 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/thz-absorption-table.h"
+#include "ns3/thz-spectrum-propagation-loss.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("THzAbsorptionTableTestSuite");
+
+/**
+ * Check that a table stored in the binary format reads back exactly like the text database.
+ */
+class THzAbsorptionTableBinaryTestCase : public TestCase
+{
+  public:
+    THzAbsorptionTableBinaryTestCase();
+    ~THzAbsorptionTableBinaryTestCase();
+    void DoRun(void);
+};
+
+THzAbsorptionTableBinaryTestCase::THzAbsorptionTableBinaryTestCase()
+    : TestCase("Terahertz absorption table binary round trip test case")
+{
+}
+
+THzAbsorptionTableBinaryTestCase::~THzAbsorptionTableBinaryTestCase()
+{
+}
+
+void
+THzAbsorptionTableBinaryTestCase::DoRun()
+{
+    std::string dir = THzAbsorptionTable::GetDataDirectory();
+    Ptr<THzAbsorptionTable> text =
+        Create<THzAbsorptionTable>(dir + "/data_frequency.txt", dir + "/data_AbsCoe.txt");
+    std::string binaryFile = CreateTempDirFilename("data_absorption.bin");
+    text->WriteBinary(binaryFile);
+    Ptr<THzAbsorptionTable> binary = Create<THzAbsorptionTable>(binaryFile);
+
+    NS_TEST_ASSERT_MSG_EQ(binary->GetSize(), text->GetSize(), "number of grid points differs");
+    for (uint32_t i = 0; i < text->GetSize(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(binary->GetFrequency(i), text->GetFrequency(i), "frequency differs");
+        NS_TEST_ASSERT_MSG_EQ(binary->GetCoefficient(i),
+                              text->GetCoefficient(i),
+                              "coefficient differs");
+    }
+
+    // lookups used by the loss model
+    uint32_t mid = text->GetSize() / 2;
+    double f = text->GetFrequency(mid);
+    NS_TEST_ASSERT_MSG_EQ(text->FindFrequency(f) <= mid, true, "lower bound past the grid point");
+    NS_TEST_ASSERT_MSG_EQ(text->GetFrequency(text->FindFrequency(f)), f, "lower bound mismatch");
+    NS_TEST_ASSERT_MSG_EQ(binary->GetNearestCoefficient(f, 9.894e8),
+                          text->GetNearestCoefficient(f, 9.894e8),
+                          "nearest coefficient differs");
+    NS_TEST_ASSERT_MSG_EQ(text->GetNearestCoefficient(1.0, 9.894e8),
+                          0.0,
+                          "a frequency far below the grid must have no coefficient");
+    NS_TEST_ASSERT_MSG_EQ(text->InterpolateCoefficient(0.0),
+                          text->GetCoefficient(0),
+                          "interpolation must clamp below the grid");
+}
+
+/**
+ * Check the absorption scale of THzSpectrumPropagationLoss: it is 1 in the atmosphere of the
+ * database, drops at a line center and grows in the wings when the pressure broadens the lines,
+ * and grows with the humidity.
+ */
+class THzAbsorptionScaleTestCase : public TestCase
+{
+  public:
+    THzAbsorptionScaleTestCase();
+    ~THzAbsorptionScaleTestCase();
+    void DoRun(void);
+};
+
+THzAbsorptionScaleTestCase::THzAbsorptionScaleTestCase()
+    : TestCase("Terahertz absorption environment scale test case")
+{
+}
+
+THzAbsorptionScaleTestCase::~THzAbsorptionScaleTestCase()
+{
+}
+
+void
+THzAbsorptionScaleTestCase::DoRun()
+{
+    double lineCenter = 556.936e9; // strongest water vapor line below 1 THz
+    double window = 1.0345e12;     // center of the 1.0345 THz preset, between lines
+    double frequencies[] = {300e9, lineCenter, 700e9, window, 3e12};
+
+    Ptr<THzSpectrumPropagationLoss> loss = CreateObject<THzSpectrumPropagationLoss>();
+    for (double f : frequencies)
+    {
+        NS_TEST_ASSERT_MSG_EQ(loss->GetAbsorptionScale(f), 1.0, "the database must be unchanged");
+    }
+
+    // the database atmosphere: 10% water vapor molecules at 296 K and 101325 Pa, where the
+    // saturation vapor pressure is 2784.4 Pa
+    loss->SetEnvironment(0.1 * 101325 / 2784.44 * 100, 296, 101325);
+    for (double f : frequencies)
+    {
+        NS_TEST_ASSERT_MSG_EQ_TOL(loss->GetAbsorptionScale(f),
+                                  1.0,
+                                  1e-4,
+                                  "the atmosphere of the database must not be scaled");
+    }
+
+    // pressure broadening lowers the peak of a line and raises its wings
+    loss->SetEnvironment(50, 298.15, 101325);
+    double centerScale = loss->GetAbsorptionScale(lineCenter);
+    double windowScale = loss->GetAbsorptionScale(window);
+    loss->SetEnvironment(50, 298.15, 2 * 101325);
+    NS_TEST_ASSERT_MSG_LT(loss->GetAbsorptionScale(lineCenter),
+                          0.6 * centerScale,
+                          "a higher pressure must lower the line center");
+    NS_TEST_ASSERT_MSG_GT(loss->GetAbsorptionScale(window),
+                          1.6 * windowScale,
+                          "a higher pressure must raise the wings");
+
+    // more water vapor absorbs more, in the wings faster than its density by self broadening
+    loss->SetEnvironment(25, 298.15, 101325);
+    double lowScale = loss->GetAbsorptionScale(window);
+    loss->SetEnvironment(75, 298.15, 101325);
+    NS_TEST_ASSERT_MSG_GT(loss->GetAbsorptionScale(window),
+                          3 * lowScale,
+                          "the wings must grow faster than the water vapor density");
+
+    loss->SetEnvironment(-1, 250, 50000);
+    NS_TEST_ASSERT_MSG_EQ(loss->GetAbsorptionScale(window), 1.0, "a negative humidity must reset");
+}
+
+class THzAbsorptionTableTestSuite : public TestSuite
+{
+  public:
+    THzAbsorptionTableTestSuite();
+};
+
+THzAbsorptionTableTestSuite::THzAbsorptionTableTestSuite()
+    : TestSuite("thz-absorption-table", UNIT)
+{
+    AddTestCase(new THzAbsorptionTableBinaryTestCase, TestCase::QUICK);
+    AddTestCase(new THzAbsorptionScaleTestCase, TestCase::QUICK);
+}
+
+// Create an instance of the test suite
+THzAbsorptionTableTestSuite g_thzAbsorptionTableTestSuite;
@@ -0,0 +1,276 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include "ns3/thz-channel.h"
+#include "ns3/thz-codebook-antenna.h"
+#include "ns3/thz-net-device.h"
+#include "ns3/thz-phy.h"
+#include "ns3/thz-spectrum-signal-parameters.h"
+#include "ns3/thz-spectrum-waveform.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("THzCodebookAntennaTestSuite");
+
+/**
+ * Check that the two-level beam search finds the beam of an exhaustive search over the codebook.
+ */
+class THzCodebookAntennaSearchTestCase : public TestCase
+{
+  public:
+    THzCodebookAntennaSearchTestCase();
+    ~THzCodebookAntennaSearchTestCase();
+    void DoRun(void);
+};
+
+THzCodebookAntennaSearchTestCase::THzCodebookAntennaSearchTestCase()
+    : TestCase("Terahertz codebook antenna beam search test case")
+{
+}
+
+THzCodebookAntennaSearchTestCase::~THzCodebookAntennaSearchTestCase()
+{
+}
+
+void
+THzCodebookAntennaSearchTestCase::DoRun()
+{
+    Ptr<THzCodebookAntenna> antenna = CreateObject<THzCodebookAntenna>();
+    antenna->SetAttribute("NumBeams", UintegerValue(32));
+    antenna->SetAttribute("NumCoarseBeams", UintegerValue(4));
+    Ptr<const THzCodebook> codebook = antenna->GetCodebook();
+    NS_TEST_ASSERT_MSG_EQ(codebook->nBeams, 32, "codebook does not follow NumBeams");
+
+    std::vector<double> gainDb;
+    for (uint32_t k = 0; k <= 3600; k++)
+    {
+        double azimuth = -M_PI + k * (M_PI + M_PI) / 3600;
+        codebook->GetGainsDb(azimuth, gainDb);
+        double best = *std::max_element(gainDb.begin(), gainDb.end());
+        uint32_t beam = antenna->SearchBestBeam(azimuth);
+        NS_TEST_ASSERT_MSG_EQ_TOL(gainDb[beam], best, 1e-9, "two-level search missed the best beam");
+        NS_TEST_ASSERT_MSG_EQ_TOL(codebook->GetGainDb(beam, azimuth),
+                                  gainDb[beam],
+                                  1e-12,
+                                  "single beam and candidate gains differ");
+    }
+
+    // a beam points at its steering azimuth with the full array gain
+    double steering = -M_PI + 0.5 * (M_PI + M_PI) / 32;
+    NS_TEST_ASSERT_MSG_EQ(antenna->SearchBestBeam(steering), 0, "wrong beam at its own steering");
+    NS_TEST_ASSERT_MSG_EQ_TOL(codebook->GetGainDb(0, steering),
+                              5.0 + 10 * std::log10(16.0),
+                              0.1,
+                              "peak gain differs from element gain plus array gain");
+
+    // antennas configured alike share one codebook
+    Ptr<THzCodebookAntenna> other = CreateObject<THzCodebookAntenna>();
+    other->SetAttribute("NumBeams", UintegerValue(32));
+    other->SetAttribute("NumCoarseBeams", UintegerValue(4));
+    NS_TEST_ASSERT_MSG_EQ(other->GetCodebook(), codebook, "codebook is not shared");
+}
+
+/**
+ * PHY that only counts the receptions the channel starts on it.
+ */
+class THzCodebookTestPhy : public THzPhy
+{
+  public:
+    THzCodebookTestPhy()
+        : m_nRx(0)
+    {
+    }
+
+    void Clear() override
+    {
+    }
+
+    void CalTxPsd() override
+    {
+    }
+
+    void SetDevice(Ptr<THzNetDevice> device) override
+    {
+    }
+
+    void SetMac(Ptr<THzMac> mac) override
+    {
+    }
+
+    void SetChannel(Ptr<THzChannel> channel) override
+    {
+    }
+
+    void SetTxPower(double dBm) override
+    {
+    }
+
+    Ptr<THzChannel> GetChannel() override
+    {
+        return 0;
+    }
+
+    Ptr<const SpectrumModel> GetRxSpectrumModel() const override
+    {
+        return 0;
+    }
+
+    Mac48Address GetAddress() override
+    {
+        return Mac48Address();
+    }
+
+    double GetTxPower() override
+    {
+        return 0;
+    }
+
+    bool SendPacket(Ptr<Packet> packet, bool rate, uint16_t mcs) override
+    {
+        return false;
+    }
+
+    void SendPacketDone(Ptr<Packet> packet) override
+    {
+    }
+
+    void ReceivePacket(Ptr<Packet> packet, Time txDuration, double_t rxPower) override
+    {
+        m_nRx++;
+    }
+
+    void ReceivePacketDone(Ptr<Packet> packet, double rxPower) override
+    {
+    }
+
+    Time CalTxDuration(uint32_t basicSize, uint32_t dataSize, uint8_t mcs) override
+    {
+        return Seconds(0);
+    }
+
+    uint32_t m_nRx; //!< receptions started on this PHY
+};
+
+/**
+ * Check that the SpatialIndex of THzChannel delivers a transmission between codebook antennas
+ * facing each other, at a distance only reachable with the peak gain of the codebook.
+ */
+class THzCodebookAntennaSpatialIndexTestCase : public TestCase
+{
+  public:
+    THzCodebookAntennaSpatialIndexTestCase();
+    ~THzCodebookAntennaSpatialIndexTestCase();
+    void DoRun(void);
+};
+
+THzCodebookAntennaSpatialIndexTestCase::THzCodebookAntennaSpatialIndexTestCase()
+    : TestCase("Terahertz codebook antenna spatial index test case")
+{
+}
+
+THzCodebookAntennaSpatialIndexTestCase::~THzCodebookAntennaSpatialIndexTestCase()
+{
+}
+
+void
+THzCodebookAntennaSpatialIndexTestCase::DoRun()
+{
+    Ptr<THzChannel> channel = CreateObject<THzChannel>();
+    channel->SetAttribute("SpatialIndex", BooleanValue(true));
+    Ptr<THzSpectrumPropagationLoss> loss = channel->GetPropagationLossModel();
+
+    Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+    sf->THzPulseSpectrumWaveformInitializer();
+    Ptr<THzSpectrumSignalParameters> txParams = Create<THzSpectrumSignalParameters>();
+    txParams->txDuration = NanoSeconds(1);
+    txParams->txPower = 1e-5;
+    txParams->numberOfSamples = sf->m_numsample;
+    txParams->numberOfSubBands = sf->m_numsb;
+    txParams->subBandBandwidth = sf->m_sbw;
+    txParams->txPsd = sf->CreatePulsePowerSpectralDensity(1, 100e-15, txParams->txPower);
+    txParams->packet = Create<Packet>(100);
+
+    // the transmitter at the origin and the receiver along the steering azimuth of a beam
+    double azimuth = -M_PI + 32.5 * (M_PI + M_PI) / 64;
+    std::vector<Ptr<THzCodebookAntenna>> antennas;
+    std::vector<Ptr<THzCodebookTestPhy>> phys;
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<MobilityModel> mobility = CreateObject<ConstantPositionMobilityModel>();
+        node->AggregateObject(mobility);
+        Ptr<THzNetDevice> dev = CreateObject<THzNetDevice>();
+        dev->SetNode(node);
+        Ptr<THzCodebookAntenna> antenna = CreateObject<THzCodebookAntenna>();
+        antenna->SetAttribute("TuneRxTxMode", DoubleValue(k)); // 0--Transmitter; 1--Receiver
+        dev->SetDirAntenna(antenna);
+        Ptr<THzCodebookTestPhy> phy = CreateObject<THzCodebookTestPhy>();
+        channel->AddDevice(dev, phy);
+        antennas.push_back(antenna);
+        phys.push_back(phy);
+    }
+    antennas[1]->SetRxBeam(antennas[1]->SearchBestBeam(azimuth - M_PI));
+    txParams->txPhy = phys[0];
+
+    // farther than the range of the MaxGain attribute, closer than that of the codebook peak
+    double maxGain = antennas[0]->GetMaxGain();
+    DoubleValue attribute;
+    antennas[0]->GetAttribute("MaxGain", attribute);
+    NS_TEST_ASSERT_MSG_EQ_TOL(maxGain, 5.0 + 10 * std::log10(16.0), 0.1, "wrong codebook peak");
+    NS_TEST_ASSERT_MSG_GT(maxGain - 0.5, attribute.Get(), "the MaxGain attribute covers the peak");
+    double distance = loss->CalcMaxRange(txParams, 2 * maxGain - 0.5, -110.0);
+    Ptr<MobilityModel> rxMobility =
+        channel->GetDevice(1)->GetNode()->GetObject<MobilityModel>();
+    rxMobility->SetPosition(Vector(distance * std::cos(azimuth), distance * std::sin(azimuth), 0));
+
+    channel->SendPacket(txParams);
+    Simulator::Run();
+    NS_TEST_ASSERT_MSG_EQ(phys[1]->m_nRx, 1, "the spatial index culled a reachable receiver");
+    channel->Clear();
+    Simulator::Destroy();
+}
+
+class THzCodebookAntennaTestSuite : public TestSuite
+{
+  public:
+    THzCodebookAntennaTestSuite();
+};
+
+THzCodebookAntennaTestSuite::THzCodebookAntennaTestSuite()
+    : TestSuite("thz-codebook-antenna", UNIT)
+{
+    AddTestCase(new THzCodebookAntennaSearchTestCase, TestCase::QUICK);
+    AddTestCase(new THzCodebookAntennaSpatialIndexTestCase, TestCase::QUICK);
+}
+
+// Create an instance of the test suite
+THzCodebookAntennaTestSuite g_thzCodebookAntennaTestSuite;
@@ -20,6 +20,7 @@
  *         Josep Miquel Jornet <j.jornet@northeastern.edu>
  */
 
+#include "ns3/boolean.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/double.h"
 #include "ns3/gnuplot.h"
@@ -103,6 +104,157 @@ THzDirectionalAntennaTestCase::DoRun()
     plotFile.close();
 }
 
+/**
+ * Check the 3D pattern against the analytic cosine patterns, and that a ceiling-mounted antenna
+ * facing down gives the same gain to peers at the same angle off nadir.
+ */
+class THzDirectionalAntennaPattern3DTestCase : public TestCase
+{
+  public:
+    THzDirectionalAntennaPattern3DTestCase();
+    ~THzDirectionalAntennaPattern3DTestCase();
+    void DoRun(void);
+};
+
+THzDirectionalAntennaPattern3DTestCase::THzDirectionalAntennaPattern3DTestCase()
+    : TestCase("Terahertz Directional Antenna 3D pattern test case")
+{
+}
+
+THzDirectionalAntennaPattern3DTestCase::~THzDirectionalAntennaPattern3DTestCase()
+{
+}
+
+void
+THzDirectionalAntennaPattern3DTestCase::DoRun()
+{
+    double beamwidth = 40;  // [deg] Beamwidth in azimuth and elevation
+    double gain_max = 14.12; // [dBi] Maximum antenna gain
+    double exponent = -3.0 / (20 * std::log10(std::cos(beamwidth * M_PI / 180 / 4.0)));
+
+    // a 1 degree grid stays within 0.011 dB of the analytic pattern over the front hemisphere
+    Ptr<THzDirectionalAntenna> antenna = CreateObject<THzDirectionalAntenna>();
+    antenna->SetAttribute("Pattern3D", BooleanValue(true));
+    antenna->SetAttribute("ElevationBeamWidth", DoubleValue(beamwidth));
+    antenna->SetBeamwidth(beamwidth);
+    antenna->SetMaxGain(gain_max);
+    for (double az = -90; az <= 90; az += 0.37)
+    {
+        for (double el = -89; el <= 89; el += 0.53)
+        {
+            double phi = az * M_PI / 180;
+            double theta = el * M_PI / 180;
+            double expected = 20 * exponent * std::log10(std::cos(phi / 2.0)) +
+                              20 * exponent * std::log10(std::cos(theta / 2.0)) + gain_max;
+            // the transmitter adds its boresight gain
+            double gain = antenna->GetAntennaGain(phi, 0, 1, 0, 0, theta) - gain_max;
+            NS_TEST_ASSERT_MSG_EQ_TOL(gain, expected, 0.011, "3D pattern off the analytic gain");
+        }
+    }
+
+    // a ceiling-mounted receiver facing down, and transmitters 18 degrees off nadir
+    antenna->SetAttribute("Tilt", DoubleValue(-90));
+    Ptr<MobilityModel> ap = CreateObject<ConstantPositionMobilityModel>();
+    ap->SetPosition(Vector(0, 0, 3));
+    double offset = 3 * std::tan(18 * M_PI / 180);
+    double expected = 20 * exponent * std::log10(std::cos(18 * M_PI / 180 / 2.0)) + 2 * gain_max;
+    Vector clients[] = {Vector(offset, 0, 0), Vector(-offset, 0, 0), Vector(0, offset, 0)};
+    for (const Vector& position : clients)
+    {
+        Ptr<MobilityModel> client = CreateObject<ConstantPositionMobilityModel>();
+        client->SetPosition(position);
+        double gain = antenna->GetAntennaGain(client, ap, 0, 1, 0);
+        NS_TEST_ASSERT_MSG_EQ_TOL(gain, expected, 0.011, "gain depends on the side of nadir");
+    }
+}
+
+/**
+ * Check the gain table against the cosine pattern, and that it follows SetBeamwidth and
+ * SetMaxGain.
+ */
+class THzDirectionalAntennaGainTableTestCase : public TestCase
+{
+  public:
+    THzDirectionalAntennaGainTableTestCase();
+    ~THzDirectionalAntennaGainTableTestCase();
+    void DoRun(void);
+
+  private:
+    /**
+     * \param table the antenna reading its gains from a table.
+     * \param exact the antenna computing its gains from the pattern, with the same settings.
+     * \param tolerance the largest difference allowed between their receive gains [dB].
+     */
+    void CheckGains(Ptr<THzDirectionalAntenna> table,
+                    Ptr<THzDirectionalAntenna> exact,
+                    double tolerance);
+};
+
+THzDirectionalAntennaGainTableTestCase::THzDirectionalAntennaGainTableTestCase()
+    : TestCase("Terahertz Directional Antenna gain table test case")
+{
+}
+
+THzDirectionalAntennaGainTableTestCase::~THzDirectionalAntennaGainTableTestCase()
+{
+}
+
+void
+THzDirectionalAntennaGainTableTestCase::CheckGains(Ptr<THzDirectionalAntenna> table,
+                                                   Ptr<THzDirectionalAntenna> exact,
+                                                   double tolerance)
+{
+    // angles between the points of the table over the main half-plane
+    for (double az = -90; az <= 90; az += 0.13)
+    {
+        double phi = az * M_PI / 180;
+        NS_TEST_ASSERT_MSG_EQ_TOL(table->GetAntennaGain(phi, 0, 1, 0, 0),
+                                  exact->GetAntennaGain(phi, 0, 1, 0, 0),
+                                  tolerance,
+                                  "gain table off the pattern at " << az << " degrees");
+    }
+}
+
+void
+THzDirectionalAntennaGainTableTestCase::DoRun()
+{
+    Ptr<THzDirectionalAntenna> table = CreateObject<THzDirectionalAntenna>();
+    table->SetAttribute("GainTableResolution", DoubleValue(1));
+    Ptr<THzDirectionalAntenna> exact = CreateObject<THzDirectionalAntenna>();
+
+    // a 1 degree grid stays within 0.008 dB of the pattern of a 27.7 degree beam
+    for (Ptr<THzDirectionalAntenna> antenna : {table, exact})
+    {
+        antenna->SetBeamwidth(27.7);
+        antenna->SetMaxGain(17.27);
+    }
+    CheckGains(table, exact, 0.008);
+
+    // the nearest point of the grid is off by up to half a degree
+    table->SetAttribute("GainTableInterpolation", BooleanValue(false));
+    NS_TEST_ASSERT_MSG_GT(std::abs(table->GetAntennaGain(M_PI / 4 + M_PI / 360, 0, 1, 0, 0) -
+                                   exact->GetAntennaGain(M_PI / 4 + M_PI / 360, 0, 1, 0, 0)),
+                          0.008,
+                          "the nearest point was interpolated");
+    table->SetAttribute("GainTableInterpolation", BooleanValue(true));
+
+    // a wider beam and a lower maximum gain, set after the first table was built
+    for (Ptr<THzDirectionalAntenna> antenna : {table, exact})
+    {
+        antenna->SetBeamwidth(60);
+        antenna->SetMaxGain(10);
+    }
+    CheckGains(table, exact, 0.008);
+    NS_TEST_ASSERT_MSG_EQ_TOL(table->GetAntennaGain(0, 0, 1, 0, 0),
+                              20.0,
+                              1e-9,
+                              "the table kept the previous maximum gain");
+    NS_TEST_ASSERT_MSG_EQ_TOL(table->GetAntennaGain(M_PI / 6, 0, 1, 0, 0),
+                              17.0,
+                              0.008,
+                              "the table kept the previous beamwidth");
+}
+
 class THzDirectionalAntennaTestSuite : public TestSuite
 {
   public:
@@ -113,6 +265,8 @@ THzDirectionalAntennaTestSuite::THzDirectionalAntennaTestSuite()
     : TestSuite("thz-directional-antenna", UNIT)
 {
     AddTestCase(new THzDirectionalAntennaTestCase, TestCase::QUICK);
+    AddTestCase(new THzDirectionalAntennaPattern3DTestCase, TestCase::QUICK);
+    AddTestCase(new THzDirectionalAntennaGainTableTestCase, TestCase::QUICK);
 }
 
 // Create an instance of the test suite
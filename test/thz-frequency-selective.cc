@@ -0,0 +1,250 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/thz-channel.h"
+#include "ns3/thz-mac.h"
+#include "ns3/thz-net-device.h"
+#include "ns3/thz-phy-macro.h"
+
+#include <cmath>
+#include <map>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("THzFrequencySelectiveTestSuite");
+
+/**
+ * MAC that only records whether the PHY decoded each packet.
+ */
+class THzSinrTestMac : public THzMac
+{
+  public:
+    void AttachPhy(Ptr<THzPhy> phy) override
+    {
+    }
+
+    void SetDevice(Ptr<THzNetDevice> dev) override
+    {
+    }
+
+    void SetAddress(Mac48Address addr) override
+    {
+    }
+
+    Mac48Address GetAddress(void) const override
+    {
+        return Mac48Address();
+    }
+
+    Mac48Address GetBroadcast(void) const override
+    {
+        return Mac48Address::GetBroadcast();
+    }
+
+    bool Enqueue(Ptr<Packet> pkt, Mac48Address dest) override
+    {
+        return false;
+    }
+
+    void SendPacketDone(Ptr<Packet> packet) override
+    {
+    }
+
+    void ReceivePacket(Ptr<THzPhy> phy, Ptr<Packet> packet) override
+    {
+    }
+
+    void ReceivePacketDone(Ptr<THzPhy> phy, Ptr<Packet> packet, bool success, double rxPower)
+        override
+    {
+        m_decoded[packet->GetUid()] = success;
+    }
+
+    void SetForwardUpCb(Callback<void, Ptr<Packet>, Mac48Address, Mac48Address> cb) override
+    {
+    }
+
+    void Clear(void) override
+    {
+    }
+
+    std::map<uint64_t, bool> m_decoded; //!< decoding result by packet uid
+};
+
+/**
+ * Check the effective SINR of FrequencySelective mode: the noise of a signal occupying part of
+ * the bands, an interferer overlapping part of the bands, and an interferer ending at the same
+ * instant as the desired signal but handled first.
+ */
+class THzFrequencySelectiveTestCase : public TestCase
+{
+  public:
+    THzFrequencySelectiveTestCase();
+    ~THzFrequencySelectiveTestCase();
+    void DoRun(void);
+
+  private:
+    /**
+     * \param sinrTh the SINR threshold of the PHY (dB).
+     * \param halfDesired if true, the desired signal only occupies the lower half of the bands.
+     * \param interferenceDbm the power of the interferer (dBm), or 0 for none.
+     * \param halfInterferer if true, the interferer only occupies the lower half of the bands.
+     *
+     * \return true if the desired packet is decoded. The interferer starts and ends with the
+     *         desired signal, with its reception done first, and a weak third signal keeps the
+     *         PHY busy past both.
+     */
+    bool Decode(double sinrTh, bool halfDesired, double interferenceDbm, bool halfInterferer);
+};
+
+THzFrequencySelectiveTestCase::THzFrequencySelectiveTestCase()
+    : TestCase("Terahertz frequency selective SINR test case")
+{
+}
+
+THzFrequencySelectiveTestCase::~THzFrequencySelectiveTestCase()
+{
+}
+
+bool
+THzFrequencySelectiveTestCase::Decode(double sinrTh,
+                                      bool halfDesired,
+                                      double interferenceDbm,
+                                      bool halfInterferer)
+{
+    Ptr<THzChannel> channel = CreateObject<THzChannel>();
+    Ptr<Node> node = CreateObject<Node>();
+    Ptr<THzNetDevice> dev = CreateObject<THzNetDevice>();
+    dev->SetNode(node);
+    Ptr<THzSinrTestMac> mac = CreateObject<THzSinrTestMac>();
+    Ptr<THzPhyMacro> phy = CreateObject<THzPhyMacro>();
+    phy->SetAttribute("FrequencySelective", BooleanValue(true));
+    phy->SetAttribute("SinrTh", DoubleValue(sinrTh));
+    phy->SetAttribute("CsPowerTh", DoubleValue(-200));
+    phy->SetDevice(dev);
+    phy->SetMac(mac);
+    phy->SetChannel(channel);
+    phy->CalTxPsd();
+
+    // flat PSDs over the bands of the PHY, or over their lower half
+    Ptr<SpectrumValue> full = Create<SpectrumValue>(phy->GetRxSpectrumModel());
+    *full = 1.0;
+    Ptr<SpectrumValue> half = full->Copy();
+    for (std::size_t b = half->GetValuesN() / 2; b < half->GetValuesN(); b++)
+    {
+        (*half)[b] = 0;
+    }
+    Ptr<const SpectrumValue> desiredPsd = halfDesired ? half : full;
+    Ptr<const SpectrumValue> interfererPsd = halfInterferer ? half : full;
+
+    Time start = MicroSeconds(1);
+    Time duration = MicroSeconds(10);
+    Ptr<Packet> desired = Create<Packet>(100);
+    Ptr<Packet> interferer = Create<Packet>(100);
+    Ptr<Packet> tail = Create<Packet>(100);
+    Ptr<const SpectrumValue> tailPsd = full;
+    Simulator::Schedule(start, &THzPhyMacro::NotifyRxSignal, phy, desired, -100.0, desiredPsd);
+    Simulator::Schedule(start, &THzPhyMacro::ReceivePacket, phy, desired, duration, -100.0);
+    if (interferenceDbm != 0)
+    {
+        Simulator::Schedule(start,
+                            &THzPhyMacro::NotifyRxSignal,
+                            phy,
+                            interferer,
+                            interferenceDbm,
+                            interfererPsd);
+        Simulator::Schedule(start,
+                            &THzPhyMacro::ReceivePacket,
+                            phy,
+                            interferer,
+                            duration,
+                            interferenceDbm);
+        Simulator::Schedule(start + duration,
+                            &THzPhyMacro::ReceivePacketDone,
+                            phy,
+                            interferer,
+                            interferenceDbm);
+    }
+    Simulator::Schedule(start, &THzPhyMacro::NotifyRxSignal, phy, tail, -150.0, tailPsd);
+    Simulator::Schedule(start, &THzPhyMacro::ReceivePacket, phy, tail, 2 * duration, -150.0);
+    Simulator::Schedule(start + duration, &THzPhyMacro::ReceivePacketDone, phy, desired, -100.0);
+    Simulator::Schedule(start + 2 * duration, &THzPhyMacro::ReceivePacketDone, phy, tail, -150.0);
+    Simulator::Run();
+    Simulator::Destroy();
+
+    std::map<uint64_t, bool>::const_iterator it = mac->m_decoded.find(desired->GetUid());
+    NS_TEST_EXPECT_MSG_EQ((it != mac->m_decoded.end()), true, "the desired packet was dropped");
+    return it != mac->m_decoded.end() && it->second;
+}
+
+void
+THzFrequencySelectiveTestCase::DoRun()
+{
+    // bands of equal width
+    Config::SetDefault("ns3::THzSpectrumValueFactory::NumSample", DoubleValue(32));
+
+    double signalW = 1e-13;  // -100 dBm
+    double noiseW = 1e-14;   // -110 dBm, the NoiseFloor of the channel
+    double tailW = 1e-18;    // -150 dBm
+    double interfererW = 1e-13;
+    double margin = 0.05;    // [dB]
+
+    // a signal in half of the bands sees the noise of those bands only
+    double sinrDb = 10 * std::log10(2 * signalW / (noiseW + tailW));
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb - margin, true, 0, false), true, "SNR too low");
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb + margin, true, 0, false), false, "SNR too high");
+
+    // an interferer in the lower half doubles its power density there
+    double low = signalW / (noiseW + tailW + 2 * interfererW);
+    double high = signalW / (noiseW + tailW);
+    sinrDb = 10 * std::log10(std::sqrt((1 + low) * (1 + high)) - 1);
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb - margin, false, -100, true), true, "SINR too low");
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb + margin, false, -100, true), false, "SINR too high");
+
+    // an interferer ending with the desired signal interferes even when handled first
+    sinrDb = 10 * std::log10(signalW / (noiseW + tailW + interfererW));
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb - margin, false, -100, false), true, "SINR too low");
+    NS_TEST_ASSERT_MSG_EQ(Decode(sinrDb + margin, false, -100, false),
+                          false,
+                          "the interferer ending at the same time was ignored");
+}
+
+class THzFrequencySelectiveTestSuite : public TestSuite
+{
+  public:
+    THzFrequencySelectiveTestSuite();
+};
+
+THzFrequencySelectiveTestSuite::THzFrequencySelectiveTestSuite()
+    : TestSuite("thz-frequency-selective", UNIT)
+{
+    AddTestCase(new THzFrequencySelectiveTestCase, TestCase::QUICK);
+}
+
+// Create an instance of the test suite
+THzFrequencySelectiveTestSuite g_thzFrequencySelectiveTestSuite;
@@ -20,16 +20,23 @@
  *         Josep Miquel Jornet <j.jornet@northeastern.edu>
  */
 
+#include "ns3/boolean.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/double.h"
 #include "ns3/gnuplot.h"
 #include "ns3/log.h"
 #include "ns3/test.h"
+#include "ns3/thz-band-presets.h"
 #include "ns3/thz-spectrum-propagation-loss.h"
 #include "ns3/thz-spectrum-signal-parameters.h"
 #include "ns3/thz-spectrum-waveform.h"
+#include "ns3/thz-worker-pool.h"
 #include <ns3/spectrum-value.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("THzPathLossTestSuite");
@@ -117,6 +124,357 @@ THzPathLossTestCase::DoRun()
     plotFile.close();
 }
 
+/**
+ * Loss model with twice the absorption loss of THzSpectrumPropagationLoss in every band.
+ */
+class THzDoubleAbsorptionLoss : public THzSpectrumPropagationLoss
+{
+  public:
+    double CalculateAbsLoss(double f, double d) override
+    {
+        return 2 * THzSpectrumPropagationLoss::CalculateAbsLoss(f, d);
+    }
+};
+
+/**
+ * Loss model without absorption that keeps the band coefficients.
+ */
+class THzNoAbsorptionLoss : public THzSpectrumPropagationLoss
+{
+  public:
+    double GetAbsorptionCoefficient(double f) const override
+    {
+        return 0;
+    }
+
+    bool UseBandCoefficients() const override
+    {
+        return true;
+    }
+};
+
+/**
+ * Check that subclasses of THzSpectrumPropagationLoss overriding CalculateAbsLoss or
+ * GetAbsorptionCoefficient get their own received power, whatever the loss models used before.
+ */
+class THzPathLossOverrideTestCase : public TestCase
+{
+  public:
+    THzPathLossOverrideTestCase();
+    ~THzPathLossOverrideTestCase();
+    void DoRun(void);
+};
+
+THzPathLossOverrideTestCase::THzPathLossOverrideTestCase()
+    : TestCase("Terahertz path loss override test case")
+{
+}
+
+THzPathLossOverrideTestCase::~THzPathLossOverrideTestCase()
+{
+}
+
+void
+THzPathLossOverrideTestCase::DoRun()
+{
+    Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+    sf->THzPulseSpectrumWaveformInitializer();
+    Ptr<THzSpectrumSignalParameters> txParams = Create<THzSpectrumSignalParameters>();
+    txParams->txDuration = Seconds(0);
+    txParams->txPower = 1e-5;
+    txParams->numberOfSamples = sf->m_numsample;
+    txParams->numberOfSubBands = sf->m_numsb;
+    txParams->subBandBandwidth = sf->m_sbw;
+    txParams->txPsd = sf->CreatePulsePowerSpectralDensity(1, 100e-15, txParams->txPower);
+    Ptr<const SpectrumModel> model = txParams->txPsd->GetSpectrumModel();
+
+    Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    a->SetPosition(Vector(0, 0, 0));
+    Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+    b->SetPosition(Vector(0.01, 0, 0));
+
+    Ptr<THzSpectrumPropagationLoss> base = CreateObject<THzSpectrumPropagationLoss>();
+    double baseDbm = base->CalcRxPowerDA(txParams, a, b, 0);
+
+    // the overridden absorption loss applies even though the base coefficients exist
+    Ptr<THzSpectrumPropagationLoss> doubled = CreateObject<THzDoubleAbsorptionLoss>();
+    NS_TEST_ASSERT_MSG_EQ_TOL(doubled->CalcRxPowerDA(txParams, a, b, 0),
+                              baseDbm - 10 * std::log10(2.0),
+                              1e-9,
+                              "CalculateAbsLoss override ignored");
+    std::vector<double> distance(1, 0.01);
+    std::vector<double> pathGain;
+    doubled->CalcPathGainBatch(txParams, distance, pathGain);
+    NS_TEST_ASSERT_MSG_EQ_TOL(doubled->CalcRxPowerDbm(pathGain[0], 0),
+                              baseDbm - 10 * std::log10(2.0),
+                              1e-9,
+                              "CalculateAbsLoss override ignored by the batch");
+
+    // a subclass in the same environment builds its own band coefficients
+    Ptr<THzSpectrumPropagationLoss> clear = CreateObject<THzNoAbsorptionLoss>();
+    Ptr<const THzBandCoefficients> clearCoe = clear->GetBandCoefficients(model);
+    Ptr<const THzBandCoefficients> baseCoe = base->GetBandCoefficients(model);
+    NS_TEST_ASSERT_MSG_NE(clearCoe, baseCoe, "band coefficients shared across types");
+    double maxKf = 0;
+    for (uint32_t i = 0; i < clearCoe->kf.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(clearCoe->kf[i], 0.0, "absorption of the base type reused");
+        maxKf = std::max(maxKf, baseCoe->kf[i]);
+    }
+    NS_TEST_ASSERT_MSG_GT(maxKf, 0.0, "absorption of the subclass reused by the base type");
+    NS_TEST_ASSERT_MSG_GT(clear->CalcRxPowerDA(txParams, a, b, 0),
+                          baseDbm,
+                          "the absorption of the base type applied to the subclass");
+}
+
+/**
+ * Check that only the PSDs of the band presets are summed by the fixed-size kernel, and that it
+ * gives the path gain of the per-receiver sum.
+ */
+class THzPathLossPresetTestCase : public TestCase
+{
+  public:
+    THzPathLossPresetTestCase();
+    ~THzPathLossPresetTestCase();
+    void DoRun(void);
+
+  private:
+    /**
+     * \param subBandWidth the SubBandWidth of the factory, with the other attributes of the
+     *        1.0345 THz preset.
+     *
+     * \return the transmit parameters of a 32-band PSD.
+     */
+    Ptr<THzSpectrumSignalParameters> CreateTxParams(double subBandWidth);
+};
+
+THzPathLossPresetTestCase::THzPathLossPresetTestCase()
+    : TestCase("Terahertz path loss preset kernel test case")
+{
+}
+
+THzPathLossPresetTestCase::~THzPathLossPresetTestCase()
+{
+}
+
+Ptr<THzSpectrumSignalParameters>
+THzPathLossPresetTestCase::CreateTxParams(double subBandWidth)
+{
+    Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+    sf->SetAttribute("CentralFrequency", DoubleValue(THZ_PRESET_1_0345_THZ.centralFrequency));
+    sf->SetAttribute("TotalBandWidth", DoubleValue(THZ_PRESET_1_0345_THZ.totalBandWidth));
+    sf->SetAttribute("SubBandWidth", DoubleValue(subBandWidth));
+    sf->SetAttribute("NumSample", DoubleValue(THZ_PRESET_1_0345_THZ.numSample));
+    Ptr<THzSpectrumSignalParameters> txParams = Create<THzSpectrumSignalParameters>();
+    txParams->txDuration = Seconds(0);
+    txParams->txPower = 1;
+    txParams->txPsd = sf->CreateTxPowerSpectralDensity(txParams->txPower);
+    txParams->numberOfSamples = sf->m_numsample;
+    txParams->numberOfSubBands = sf->m_numsb;
+    txParams->subBandBandwidth = sf->m_sbw;
+    return txParams;
+}
+
+void
+THzPathLossPresetTestCase::DoRun()
+{
+    Ptr<THzSpectrumPropagationLoss> loss = CreateObject<THzSpectrumPropagationLoss>();
+    Ptr<THzSpectrumSignalParameters> preset = CreateTxParams(THZ_PRESET_1_0345_THZ.subBandWidth);
+    Ptr<THzSpectrumSignalParameters> other = CreateTxParams(2 * THZ_PRESET_1_0345_THZ.subBandWidth);
+    NS_TEST_ASSERT_MSG_EQ(preset->txPsd->GetValuesN(), THZ_PRESET_NUM_SAMPLE, "preset bands");
+    NS_TEST_ASSERT_MSG_EQ(other->txPsd->GetValuesN(), THZ_PRESET_NUM_SAMPLE, "preset bands");
+    NS_TEST_ASSERT_MSG_EQ(loss->GetBandCoefficients(preset->txPsd->GetSpectrumModel())->preset,
+                          true,
+                          "the preset PSD must use the fixed-size kernel");
+    NS_TEST_ASSERT_MSG_EQ(loss->GetBandCoefficients(other->txPsd->GetSpectrumModel())->preset,
+                          false,
+                          "a 32-band PSD of other bands must not use the fixed-size kernel");
+
+    Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    a->SetPosition(Vector(0, 0, 0));
+    Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+    std::vector<double> distance = {0.1, 1, 10, 100};
+    for (Ptr<THzSpectrumSignalParameters> txParams : {preset, other})
+    {
+        std::vector<double> pathGain;
+        loss->CalcPathGainBatch(txParams, distance, pathGain);
+        for (std::size_t r = 0; r < distance.size(); r++)
+        {
+            b->SetPosition(Vector(distance[r], 0, 0));
+            NS_TEST_ASSERT_MSG_EQ_TOL(loss->CalcRxPowerDbm(pathGain[r], 0),
+                                      loss->CalcRxPowerDA(txParams, a, b, 0),
+                                      1e-9,
+                                      "batch path gain differs from the per-receiver sum");
+        }
+    }
+}
+
+/**
+ * Check that the path gains of a batch split over a worker pool are exactly those computed on
+ * the simulation thread, so that the WorkerThreads attribute of THzChannel does not change the
+ * received power.
+ */
+class THzPathLossWorkerPoolTestCase : public TestCase
+{
+  public:
+    THzPathLossWorkerPoolTestCase();
+    ~THzPathLossWorkerPoolTestCase();
+    void DoRun(void);
+};
+
+THzPathLossWorkerPoolTestCase::THzPathLossWorkerPoolTestCase()
+    : TestCase("Terahertz path loss worker pool test case")
+{
+}
+
+THzPathLossWorkerPoolTestCase::~THzPathLossWorkerPoolTestCase()
+{
+}
+
+void
+THzPathLossWorkerPoolTestCase::DoRun()
+{
+    Ptr<THzSpectrumPropagationLoss> loss = CreateObject<THzSpectrumPropagationLoss>();
+    Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+    sf->SetAttribute("CentralFrequency", DoubleValue(THZ_PRESET_1_0345_THZ.centralFrequency));
+    sf->SetAttribute("TotalBandWidth", DoubleValue(THZ_PRESET_1_0345_THZ.totalBandWidth));
+    sf->SetAttribute("SubBandWidth", DoubleValue(THZ_PRESET_1_0345_THZ.subBandWidth));
+    sf->SetAttribute("NumSample", DoubleValue(THZ_PRESET_1_0345_THZ.numSample));
+    Ptr<THzSpectrumSignalParameters> txParams = Create<THzSpectrumSignalParameters>();
+    txParams->txDuration = Seconds(0);
+    txParams->txPower = 1;
+    txParams->txPsd = sf->CreateTxPowerSpectralDensity(txParams->txPower);
+    txParams->numberOfSamples = sf->m_numsample;
+    txParams->numberOfSubBands = sf->m_numsb;
+    txParams->subBandBandwidth = sf->m_sbw;
+
+    // enough receivers for the batch to be split, with a count the threads do not divide
+    std::vector<double> distance(4099);
+    for (std::size_t r = 0; r < distance.size(); r++)
+    {
+        distance[r] = 0.01 * std::pow(10.0, 4.0 * r / distance.size());
+    }
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(distance.size() * txParams->txPsd->GetValuesN(),
+                                65536U,
+                                "the batch is too small to be split");
+    std::vector<double> serial;
+    loss->CalcPathGainBatch(txParams, distance, serial);
+    for (uint32_t nThreads : {2, 3, 8})
+    {
+        std::vector<double> parallel;
+        loss->CalcPathGainBatch(txParams, distance, parallel, Create<THzWorkerPool>(nThreads));
+        NS_TEST_ASSERT_MSG_EQ(parallel.size(), serial.size(), "missing receivers");
+        for (std::size_t r = 0; r < distance.size(); r++)
+        {
+            NS_TEST_ASSERT_MSG_EQ(parallel[r],
+                                  serial[r],
+                                  "the path gain depends on the number of worker threads");
+        }
+    }
+}
+
+/**
+ * Check that the path gains looked up in the path gain tables stay within PathGainTableMaxError
+ * of the per-band sum over the tabulated distances, and equal it outside of them.
+ */
+class THzPathLossTableTestCase : public TestCase
+{
+  public:
+    THzPathLossTableTestCase();
+    ~THzPathLossTableTestCase();
+    void DoRun(void);
+
+  private:
+    /**
+     * \param txParams the transmitted signal.
+     * \param maxError the PathGainTableMaxError attribute (dB).
+     */
+    void CheckTable(Ptr<THzSpectrumSignalParameters> txParams, double maxError);
+};
+
+THzPathLossTableTestCase::THzPathLossTableTestCase()
+    : TestCase("Terahertz path loss table test case")
+{
+}
+
+THzPathLossTableTestCase::~THzPathLossTableTestCase()
+{
+}
+
+void
+THzPathLossTableTestCase::CheckTable(Ptr<THzSpectrumSignalParameters> txParams, double maxError)
+{
+    Ptr<THzSpectrumPropagationLoss> exact = CreateObject<THzSpectrumPropagationLoss>();
+    Ptr<THzSpectrumPropagationLoss> table = CreateObject<THzSpectrumPropagationLoss>();
+    table->SetAttribute("PathGainTable", BooleanValue(true));
+    table->SetAttribute("PathGainTableMaxError", DoubleValue(maxError));
+
+    // 97 points per decade fall everywhere in the intervals of the tables, which cover 10 um
+    // to 1000 m; the first and last decade are outside of them
+    std::vector<double> distance;
+    for (uint32_t j = 0; j <= 10 * 97; j++)
+    {
+        distance.push_back(1e-6 * std::pow(10.0, j / 97.0));
+    }
+    std::vector<double> exactGain;
+    std::vector<double> tableGain;
+    exact->CalcPathGainBatch(txParams, distance, exactGain);
+    table->CalcPathGainBatch(txParams, distance, tableGain);
+    for (std::size_t r = 0; r < distance.size(); r++)
+    {
+        if (!(exactGain[r] > 0))
+        {
+            // the received power underflows, which the table must not hide
+            NS_TEST_ASSERT_MSG_EQ(tableGain[r], exactGain[r], "underflow at " << distance[r]);
+            continue;
+        }
+        double errorDb = 10 * std::log10(tableGain[r] / exactGain[r]);
+        if (distance[r] < 0.99e-5 || distance[r] > 1.01e3)
+        {
+            NS_TEST_ASSERT_MSG_EQ_TOL(errorDb, 0.0, 1e-12, "not summed at " << distance[r]);
+        }
+        else
+        {
+            NS_TEST_ASSERT_MSG_EQ_TOL(errorDb, 0.0, maxError, "table error at " << distance[r]);
+        }
+    }
+}
+
+void
+THzPathLossTableTestCase::DoRun()
+{
+    // the pulse of the nanoscale waveform over the whole terahertz band
+    Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+    sf->THzPulseSpectrumWaveformInitializer();
+    Ptr<THzSpectrumSignalParameters> pulse = Create<THzSpectrumSignalParameters>();
+    pulse->txDuration = Seconds(0);
+    pulse->txPower = 1e-5;
+    pulse->txPsd = sf->CreatePulsePowerSpectralDensity(1, 100e-15, pulse->txPower);
+    pulse->numberOfSamples = sf->m_numsample;
+    pulse->numberOfSubBands = sf->m_numsb;
+    pulse->subBandBandwidth = sf->m_sbw;
+
+    // the 1.0345 THz preset of the macroscale waveform
+    sf = CreateObject<THzSpectrumValueFactory>();
+    sf->SetAttribute("CentralFrequency", DoubleValue(THZ_PRESET_1_0345_THZ.centralFrequency));
+    sf->SetAttribute("TotalBandWidth", DoubleValue(THZ_PRESET_1_0345_THZ.totalBandWidth));
+    sf->SetAttribute("SubBandWidth", DoubleValue(THZ_PRESET_1_0345_THZ.subBandWidth));
+    sf->SetAttribute("NumSample", DoubleValue(THZ_PRESET_1_0345_THZ.numSample));
+    Ptr<THzSpectrumSignalParameters> preset = Create<THzSpectrumSignalParameters>();
+    preset->txDuration = Seconds(0);
+    preset->txPower = 1;
+    preset->txPsd = sf->CreateTxPowerSpectralDensity(preset->txPower);
+    preset->numberOfSamples = sf->m_numsample;
+    preset->numberOfSubBands = sf->m_numsb;
+    preset->subBandBandwidth = sf->m_sbw;
+
+    for (double maxError : {0.01, 0.1})
+    {
+        CheckTable(pulse, maxError);
+        CheckTable(preset, maxError);
+    }
+}
+
 class THzPathLossTestSuite : public TestSuite
 {
   public:
@@ -127,6 +485,10 @@ THzPathLossTestSuite::THzPathLossTestSuite()
     : TestSuite("thz-path-loss", UNIT)
 {
     AddTestCase(new THzPathLossTestCase, TestCase::QUICK);
+    AddTestCase(new THzPathLossOverrideTestCase, TestCase::QUICK);
+    AddTestCase(new THzPathLossPresetTestCase, TestCase::QUICK);
+    AddTestCase(new THzPathLossWorkerPoolTestCase, TestCase::QUICK);
+    AddTestCase(new THzPathLossTableTestCase, TestCase::QUICK);
 }
 
 // Create an instance of the test suite
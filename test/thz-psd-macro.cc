@@ -32,6 +32,8 @@
 #include "ns3/thz-spectrum-waveform.h"
 #include <ns3/spectrum-value.h>
 
+#include <iterator>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("THzPsdMacroTestSuite");
@@ -122,6 +124,88 @@ THzPsdMacroTestCase::DoRun()
     plotFile.close();
 }
 
+/**
+ * Check that the received power of a PSD with the adaptive band layout is within 0.04 dB of
+ * that of a uniform layout 256 times finer, over windows with and without absorption lines.
+ */
+class THzPsdMacroAdaptiveTestCase : public TestCase
+{
+  public:
+    THzPsdMacroAdaptiveTestCase();
+    ~THzPsdMacroAdaptiveTestCase();
+    void DoRun(void);
+};
+
+THzPsdMacroAdaptiveTestCase::THzPsdMacroAdaptiveTestCase()
+    : TestCase("terahertz PSD Macro adaptive band layout test case")
+{
+}
+
+THzPsdMacroAdaptiveTestCase::~THzPsdMacroAdaptiveTestCase()
+{
+}
+
+void
+THzPsdMacroAdaptiveTestCase::DoRun()
+{
+    const double txPowerW = 1e-3;
+    const uint32_t numSample = 98;
+    const uint32_t oversampling = 256;
+    Ptr<THzSpectrumPropagationLoss> lossModel = CreateObject<THzSpectrumPropagationLoss>();
+    Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    a->SetPosition(Vector(0, 0, 0));
+    Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+
+    for (double fc : {0.3e12, 0.557e12, 1.03e12})
+    {
+        Ptr<THzSpectrumValueFactory> sf = CreateObject<THzSpectrumValueFactory>();
+        sf->SetAttribute("CentralFrequency", DoubleValue(fc));
+        sf->SetAttribute("TotalBandWidth", DoubleValue(numSample * 1e9));
+        sf->SetAttribute("SubBandWidth", DoubleValue(1e9));
+        sf->SetAttribute("NumSample", DoubleValue(numSample));
+        sf->SetAttribute("AdaptiveSamplingTolerance", DoubleValue(1e-2));
+        Ptr<THzSpectrumSignalParameters> adaptive = Create<THzSpectrumSignalParameters>();
+        adaptive->txDuration = Seconds(0);
+        adaptive->txPower = txPowerW;
+        adaptive->txPsd = sf->CreateTxPowerSpectralDensity(txPowerW);
+        adaptive->numberOfSamples = sf->m_numsample;
+        adaptive->numberOfSubBands = sf->m_numsb;
+        adaptive->subBandBandwidth = sf->m_sbw;
+        NS_TEST_ASSERT_MSG_LT(adaptive->txPsd->GetValuesN(), numSample, "no band was merged");
+
+        // the same window in uniform bands of 1/256 of the nominal width
+        double fl = adaptive->txPsd->ConstBandsBegin()->fl;
+        double width = (std::prev(adaptive->txPsd->ConstBandsEnd())->fh - fl) /
+                       (numSample * oversampling);
+        Bands bands(numSample * oversampling);
+        for (uint32_t j = 0; j < bands.size(); j++)
+        {
+            bands[j].fl = fl + j * width;
+            bands[j].fh = fl + (j + 1) * width;
+            bands[j].fc = (bands[j].fl + bands[j].fh) / 2;
+        }
+        Ptr<SpectrumValue> uniformPsd = Create<SpectrumValue>(Create<SpectrumModel>(bands));
+        *uniformPsd = txPowerW / (numSample * 1e9);
+        Ptr<THzSpectrumSignalParameters> uniform = Create<THzSpectrumSignalParameters>();
+        uniform->txDuration = Seconds(0);
+        uniform->txPower = txPowerW;
+        uniform->txPsd = uniformPsd;
+        uniform->numberOfSamples = 1;
+        uniform->numberOfSubBands = 1;
+        uniform->subBandBandwidth = width;
+
+        for (double distance : {0.1, 1.0, 10.0})
+        {
+            b->SetPosition(Vector(distance, 0, 0));
+            NS_TEST_ASSERT_MSG_EQ_TOL(lossModel->CalcRxPowerDA(adaptive, a, b, 0),
+                                      lossModel->CalcRxPowerDA(uniform, a, b, 0),
+                                      0.04,
+                                      "adaptive received power at " << fc << " Hz and "
+                                                                    << distance << " m");
+        }
+    }
+}
+
 class THzPsdMacroTestSuite : public TestSuite
 {
   public:
@@ -132,6 +216,7 @@ THzPsdMacroTestSuite::THzPsdMacroTestSuite()
     : TestSuite("thz-psd-macro", UNIT)
 {
     AddTestCase(new THzPsdMacroTestCase, TestCase::QUICK);
+    AddTestCase(new THzPsdMacroAdaptiveTestCase, TestCase::QUICK);
 }
 
 // Create an instance of the test suite
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Northeastern University (https://unlab.tech/)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Qing Xia <qingxia@buffalo.edu>
+ *         Zahed Hossain <zahedhos@buffalo.edu>
+ *         Josep Miquel Jornet <j.jornet@northeastern.edu>
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/thz-absorption-table.h"
+
+#include <iostream>
+#include <string>
+
+using namespace ns3;
+
+/* This program converts the text absorption database (data_frequency.txt and data_AbsCoe.txt)
+ * into the binary format of THzAbsorptionTable. When data_absorption.bin is present in the data
+ * directory, it is memory-mapped at startup instead of parsing the text files, which shortens
+ * the startup of short simulation runs. The build runs this program to generate the binary
+ * table in the data directory of the build tree, which is installed next to the library. The
+ * binary file depends on the byte order of the machine, so to use a different database, convert
+ * it on the machine that runs the simulations and point THZ_DATA_DIR to its directory:
+ *
+ *   thz-absorption-db-converter --frequencyFile=freq.txt --absCoeFile=abs.txt
+ *                               --output=mydb/data_absorption.bin
+ */
+
+NS_LOG_COMPONENT_DEFINE("THzAbsorptionDbConverter");
+
+int
+main(int argc, char* argv[])
+{
+    std::string dir = THzAbsorptionTable::GetDataDirectory();
+    std::string frequencyFile = dir + "/data_frequency.txt";
+    std::string absCoeFile = dir + "/data_AbsCoe.txt";
+    std::string output = dir + "/data_absorption.bin";
+
+    CommandLine cmd;
+    cmd.AddValue("frequencyFile", "Text file of the frequency grid", frequencyFile);
+    cmd.AddValue("absCoeFile", "Text file of the absorption coefficients", absCoeFile);
+    cmd.AddValue("output", "Binary table to write", output);
+    cmd.Parse(argc, argv);
+
+    Ptr<THzAbsorptionTable> table = Create<THzAbsorptionTable>(frequencyFile, absCoeFile);
+    table->WriteBinary(output);
+    std::cout << "Wrote " << table->GetSize() << " absorption coefficients to " << output
+              << std::endl;
+    return 0;
+}